@@ -0,0 +1,362 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include "file_reader_line_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/*
+    Throughput of line indexing before (byte-by-byte count + strchr pass)
+    and after (single pass scanners) on synthetic buffers from 1 MB up to the given size,
+    then scaling of parallel indexing from 1 to 32 threads on the largest of these buffers
+    (limited to BENCH_MAX_SCALING_SIZE_IN_MB).
+
+    usage: ./bench_line_index.out [max_size_in_MB]   (default 1024, use 4096 for 4 GB)
+*/
+
+#define BENCH_DEFAULT_MAX_SIZE_IN_MB 1024
+#define BENCH_MAX_SCALING_SIZE_IN_MB 1024
+#define BENCH_MAX_NO_OF_THREADS 32
+#define BENCH_REPETITIONS 5
+
+static char* generate_buffer(size_t file_size);
+static double now_in_seconds(void);
+static bool reference_index_lines(const char* buffer, size_t buffer_size, size_t** line_offset, size_t* no_of_lines);
+static double measure_reference(const char* buffer, size_t buffer_size, size_t* no_of_lines);
+static double measure_scanner(const char* buffer, size_t buffer_size, Line_Index_Scanner scanner,
+                              size_t expected_no_of_lines);
+static double measure_threads(const char* buffer, size_t buffer_size, size_t no_of_threads,
+                              const size_t* expected_offset, size_t expected_no_of_lines);
+static int run_scaling(size_t size_in_mb);
+
+
+int main(int argc, char** argv)
+{
+    size_t max_size_in_mb = BENCH_DEFAULT_MAX_SIZE_IN_MB;
+
+    if (argc > 1)
+    {
+        max_size_in_mb = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    const struct
+    {
+        Line_Index_Scanner scanner;
+        const char*        name;
+    } scanners[] =
+    {
+        {LINE_INDEX_SCANNER_SCALAR, "scalar"},
+        {LINE_INDEX_SCANNER_SSE2,   "sse2"},
+        {LINE_INDEX_SCANNER_AVX2,   "avx2"},
+    };
+    const size_t no_of_scanners = sizeof(scanners) / sizeof(scanners[0]);
+
+    printf("%10s %12s %12s", "size_MB", "lines", "before_GB/s");
+    for (size_t i = 0; i < no_of_scanners; ++i)
+    {
+        printf(" %10s_GB/s", scanners[i].name);
+    }
+    printf("\n");
+
+    size_t largest_size_in_mb = 0;
+
+    for (size_t size_in_mb = 1; size_in_mb <= max_size_in_mb; size_in_mb *= 4)
+    {
+        const size_t file_size = size_in_mb * 1024 * 1024;
+        char* const buffer = generate_buffer(file_size);
+        if (buffer == NULL)
+        {
+            fprintf(stderr, "Can't allocate %zu MB, stopping\n", size_in_mb);
+            break;
+        }
+
+        const size_t buffer_size = file_size + 1;
+        size_t no_of_lines = 0;
+        const double reference_seconds = measure_reference(buffer, buffer_size, &no_of_lines);
+
+        printf("%10zu %12zu %12.2f", size_in_mb, no_of_lines, (double)file_size / reference_seconds / 1e9);
+
+        for (size_t i = 0; i < no_of_scanners; ++i)
+        {
+            if (line_index_scanner_is_supported(scanners[i].scanner) == false)
+            {
+                printf(" %15s", "n/a");
+                continue;
+            }
+
+            const double seconds = measure_scanner(buffer, buffer_size, scanners[i].scanner, no_of_lines);
+            if (seconds < 0)
+            {
+                fprintf(stderr, "\nScanner %s gives different index than reference\n", scanners[i].name);
+                free(buffer);
+                return 1;
+            }
+
+            printf(" %15.2f", (double)file_size / seconds / 1e9);
+        }
+
+        printf("\n");
+        fflush(stdout);
+        free(buffer);
+        largest_size_in_mb = size_in_mb;
+    }
+
+    if (largest_size_in_mb > BENCH_MAX_SCALING_SIZE_IN_MB)
+    {
+        largest_size_in_mb = BENCH_MAX_SCALING_SIZE_IN_MB;
+    }
+
+    return largest_size_in_mb > 0 ? run_scaling(largest_size_in_mb) : 0;
+}
+
+static int run_scaling(const size_t size_in_mb)
+{
+    const size_t file_size = size_in_mb * 1024 * 1024;
+    char* const buffer = generate_buffer(file_size);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "Can't allocate %zu MB for scaling\n", size_in_mb);
+        return 1;
+    }
+
+    const size_t buffer_size = file_size + 1;
+    size_t* expected_offset = NULL;
+    size_t expected_offset_capacity = 0;
+    size_t expected_no_of_lines = 0;
+    if (line_index_build(buffer, buffer_size, LINE_INDEX_SCANNER_AUTO, NULL,
+                         &expected_offset, &expected_offset_capacity, &expected_no_of_lines) == false)
+    {
+        free(expected_offset);
+        free(buffer);
+        return 1;
+    }
+
+    printf("\n%10s %10s %12s %10s\n", "size_MB", "threads", "GB/s", "speedup");
+
+    double single_thread_seconds = 0;
+    int result = 0;
+
+    for (size_t no_of_threads = 1; no_of_threads <= BENCH_MAX_NO_OF_THREADS; no_of_threads *= 2)
+    {
+        const double seconds =
+            measure_threads(buffer, buffer_size, no_of_threads, expected_offset, expected_no_of_lines);
+        if (seconds < 0)
+        {
+            fprintf(stderr, "Parallel index with %zu threads differs from single thread one\n", no_of_threads);
+            result = 1;
+            break;
+        }
+
+        if (no_of_threads == 1)
+        {
+            single_thread_seconds = seconds;
+        }
+
+        printf("%10zu %10zu %12.2f %10.2f\n", size_in_mb, no_of_threads,
+               (double)file_size / seconds / 1e9, single_thread_seconds / seconds);
+        fflush(stdout);
+    }
+
+    free(expected_offset);
+    free(buffer);
+
+    return result;
+}
+
+/*
+    Lines of pseudo random length between 0 and 127 characters, file ends with '\n'
+*/
+static char* generate_buffer(const size_t file_size)
+{
+    char* const buffer = malloc(file_size + 1);
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    unsigned int seed = 12345;
+    size_t position = 0;
+
+    while (position < file_size)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t line_length = (seed >> 16) % 128;
+
+        if (line_length > file_size - position - 1)
+        {
+            line_length = file_size - position - 1;
+        }
+
+        memset(buffer + position, 'x', line_length);
+        position += line_length;
+        buffer[position++] = '\n';
+    }
+
+    buffer[file_size] = '\0';
+
+    return buffer;
+}
+
+static double now_in_seconds(void)
+{
+    struct timespec time_now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time_now);
+
+    return (double)time_now.tv_sec + (double)time_now.tv_nsec / 1e9;
+}
+
+/*
+    Line indexing as it was done before the single pass scanner
+*/
+static bool reference_index_lines(const char* const buffer, const size_t buffer_size,
+                                  size_t** const line_offset, size_t* const no_of_lines)
+{
+    size_t line_counter = 1;
+    const char* ptr = buffer;
+    const char* ptr_to_last_elem = buffer + buffer_size;
+
+    while (ptr < ptr_to_last_elem - 2)
+    {
+        if (*ptr == '\n')
+        {
+            ++line_counter;
+        }
+        ++ptr;
+    }
+
+    size_t* const offsets = calloc(line_counter + 1, sizeof(*offsets));
+    if (offsets == NULL)
+    {
+        return false;
+    }
+
+    const char* current_position = buffer;
+    const char* next_position = strchr(current_position, '\n');
+    size_t current_line = 0;
+
+    while (next_position != NULL)
+    {
+        current_position = next_position + 1;
+        next_position = strchr(current_position, '\n');
+        ++current_line;
+        offsets[current_line] = (size_t)(current_position - buffer);
+    }
+
+    *line_offset = offsets;
+    *no_of_lines = line_counter;
+
+    return true;
+}
+
+static double measure_reference(const char* const buffer, const size_t buffer_size, size_t* const no_of_lines)
+{
+    double best_seconds = 0;
+
+    for (size_t repetition = 0; repetition < BENCH_REPETITIONS; ++repetition)
+    {
+        size_t* line_offset = NULL;
+
+        const double start = now_in_seconds();
+        const bool is_built = reference_index_lines(buffer, buffer_size, &line_offset, no_of_lines);
+        const double seconds = now_in_seconds() - start;
+
+        free(line_offset);
+
+        if (is_built == true && (repetition == 0 || seconds < best_seconds))
+        {
+            best_seconds = seconds;
+        }
+    }
+
+    return best_seconds;
+}
+
+/*
+    Returns the best time out of all repetitions or -1 if index differs from the reference
+*/
+static double measure_scanner(const char* const buffer, const size_t buffer_size, const Line_Index_Scanner scanner,
+                              const size_t expected_no_of_lines)
+{
+    size_t* reference_offset = NULL;
+    size_t reference_no_of_lines = 0;
+    if (reference_index_lines(buffer, buffer_size, &reference_offset, &reference_no_of_lines) == false)
+    {
+        return -1;
+    }
+
+    double best_seconds = 0;
+
+    for (size_t repetition = 0; repetition < BENCH_REPETITIONS; ++repetition)
+    {
+        size_t* line_offset = NULL;
+        size_t line_offset_capacity = 0;
+        size_t no_of_lines = 0;
+
+        const double start = now_in_seconds();
+        const bool is_built =
+            line_index_build(buffer, buffer_size, scanner, NULL, &line_offset, &line_offset_capacity, &no_of_lines);
+        const double seconds = now_in_seconds() - start;
+
+        const bool is_correct = is_built == true
+            && no_of_lines == expected_no_of_lines
+            && memcmp(line_offset, reference_offset, no_of_lines * sizeof(*line_offset)) == 0;
+
+        free(line_offset);
+
+        if (is_correct == false)
+        {
+            free(reference_offset);
+            return -1;
+        }
+
+        if (repetition == 0 || seconds < best_seconds)
+        {
+            best_seconds = seconds;
+        }
+    }
+
+    free(reference_offset);
+
+    return best_seconds;
+}
+
+/*
+    Returns the best time out of all repetitions or -1 if index differs from the expected one
+*/
+static double measure_threads(const char* const buffer, const size_t buffer_size, const size_t no_of_threads,
+                              const size_t* const expected_offset, const size_t expected_no_of_lines)
+{
+    double best_seconds = 0;
+
+    for (size_t repetition = 0; repetition < BENCH_REPETITIONS; ++repetition)
+    {
+        size_t* line_offset = NULL;
+        size_t line_offset_capacity = 0;
+        size_t no_of_lines = 0;
+
+        const double start = now_in_seconds();
+        const bool is_built = line_index_build_parallel(buffer, buffer_size, LINE_INDEX_SCANNER_AUTO, no_of_threads, NULL,
+                                                        &line_offset, &line_offset_capacity, &no_of_lines);
+        const double seconds = now_in_seconds() - start;
+
+        const bool is_correct = is_built == true
+            && no_of_lines == expected_no_of_lines
+            && memcmp(line_offset, expected_offset, (no_of_lines + 1) * sizeof(*line_offset)) == 0;
+
+        free(line_offset);
+
+        if (is_correct == false)
+        {
+            return -1;
+        }
+
+        if (repetition == 0 || seconds < best_seconds)
+        {
+            best_seconds = seconds;
+        }
+    }
+
+    return best_seconds;
+}
@@ -0,0 +1,505 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include <file_reader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/*
+    Hot paths of the reader on synthetic files (short lines, long lines, no '\n' at the end,
+    mostly blank lines) of the given size and on procfs files. Each operation is repeated,
+    results are printed to stdout as JSON: percentiles of time, MB/s and ns per line of the median,
+    allocations of one repetition (counted by the reader allocator) and peak RSS of the operation.
+
+    usage: ./bench.out [size_in_MB] [repetitions]   (default 32 MB, 7 repetitions)
+*/
+
+#define BENCH_DEFAULT_SIZE_IN_MB 32
+#define BENCH_DEFAULT_REPETITIONS 7
+#define BENCH_MAX_REPETITIONS 1000
+
+typedef struct Bench_Case
+{
+    const char* name;
+    const char* file_name;
+    bool        is_synthetic;      // file is generated and removed by the benchmark
+    size_t      min_line_length;   // lines of synthetic file, without '\n'
+    size_t      max_line_length;
+    unsigned    blank_percent;     // share of empty lines in synthetic file
+    bool        has_trailing_new_line;
+    size_t      file_size;         // found when the file is loaded for the first time
+    size_t      no_of_lines;
+} Bench_Case;
+
+typedef struct Allocation_Counter
+{
+    size_t no_of_allocations;  // allocate and reallocate calls
+    size_t allocated_bytes;
+} Allocation_Counter;
+
+typedef struct Bench_Operation
+{
+    const char* name;
+    // time of the measured part, allocations are counted only in that part
+    bool (*run)(const Bench_Case* bench_case, const File_Reader_Options* options, double* seconds);
+    bool        uses_allocator;    // allocations go through the reader allocator, so they are counted
+} Bench_Operation;
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static bool generate_file(const Bench_Case* bench_case, size_t file_size);
+static bool describe_file(Bench_Case* bench_case);
+static void run_case(const Bench_Case* bench_case, size_t repetitions, bool is_last_case);
+static double now_in_seconds(void);
+static int compare_doubles(const void* first, const void* second);
+static double percentile(const double* sorted_values, size_t no_of_values, double fraction);
+static void reset_peak_rss(void);
+static long read_peak_rss_in_kb(void);
+static void* counting_allocate(void* context, size_t size);
+static void* counting_reallocate(void* context, void* memory, size_t old_size, size_t new_size);
+static void counting_deallocate(void* context, void* memory);
+static bool run_new(const Bench_Case* bench_case, const File_Reader_Options* options, double* seconds);
+static bool run_count_lines(const Bench_Case* bench_case, const File_Reader_Options* options, double* seconds);
+static bool run_index_build(const Bench_Case* bench_case, const File_Reader_Options* options, double* seconds);
+static bool run_copy_of_each_line(const Bench_Case* bench_case, const File_Reader_Options* options, double* seconds);
+static bool run_copy_of_file_buffer(const Bench_Case* bench_case, const File_Reader_Options* options, double* seconds);
+
+static const Bench_Operation bench_operations[] =
+{
+    {"new",                 run_new,                 true},
+    {"count_lines",         run_count_lines,         false},
+    {"index_build",         run_index_build,         true},
+    {"copy_of_each_line",   run_copy_of_each_line,   true},
+    {"copy_of_file_buffer", run_copy_of_file_buffer, true},
+};
+
+
+int main(int argc, char** argv)
+{
+    size_t size_in_mb = BENCH_DEFAULT_SIZE_IN_MB;
+    size_t repetitions = BENCH_DEFAULT_REPETITIONS;
+
+    if (argc > 1)
+    {
+        size_in_mb = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    if (argc > 2)
+    {
+        repetitions = (size_t)strtoull(argv[2], NULL, 10);
+    }
+
+    if (size_in_mb == 0 || repetitions == 0 || repetitions > BENCH_MAX_REPETITIONS)
+    {
+        fprintf(stderr, "usage: %s [size_in_MB] [repetitions (1 - %d)]\n", argv[0], BENCH_MAX_REPETITIONS);
+        return 1;
+    }
+
+    Bench_Case bench_cases[] =
+    {
+        {"short_lines",         "bench_short_lines.txt",         true,  0,    32,   0,  true,  0, 0},
+        {"long_lines",          "bench_long_lines.txt",          true,  1000, 8000, 0,  true,  0, 0},
+        {"no_trailing_newline", "bench_no_trailing_newline.txt", true,  20,   120,  0,  false, 0, 0},
+        {"blank_lines",         "bench_blank_lines.txt",         true,  1,    40,   90, true,  0, 0},
+        {"proc_self_maps",      "/proc/self/maps",               false, 0,    0,    0,  true,  0, 0},
+        {"proc_self_smaps",     "/proc/self/smaps",              false, 0,    0,    0,  true,  0, 0},
+        {"proc_cpuinfo",        "/proc/cpuinfo",                 false, 0,    0,    0,  true,  0, 0},
+    };
+    const size_t no_of_cases = sizeof(bench_cases) / sizeof(bench_cases[0]);
+    const size_t file_size = size_in_mb * 1024 * 1024;
+
+    printf("{\n  \"benchmark\": \"file_reader\",\n  \"size_in_mb\": %zu,\n  \"repetitions\": %zu,\n  \"cases\": [\n",
+           size_in_mb, repetitions);
+
+    bool is_failed = false;
+
+    for (size_t i = 0; i < no_of_cases; ++i)
+    {
+        Bench_Case* const bench_case = &bench_cases[i];
+        fprintf(stderr, "%s\n", bench_case->name);
+
+        if (bench_case->is_synthetic == true && generate_file(bench_case, file_size) == false)
+        {
+            fprintf(stderr, "Can't generate \"%s\"\n", bench_case->file_name);
+            is_failed = true;
+            break;
+        }
+
+        if (describe_file(bench_case) == false)
+        {
+            fprintf(stderr, "Can't read \"%s\"\n", bench_case->file_name);
+            is_failed = true;
+        }
+        else
+        {
+            run_case(bench_case, repetitions, i == no_of_cases - 1);
+        }
+
+        if (bench_case->is_synthetic == true)
+        {
+            remove(bench_case->file_name);
+        }
+    }
+
+    printf("  ]\n}\n");
+
+    return is_failed == true ? 1 : 0;
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Lines of random length and content, the last line is cut to get exactly file_size bytes
+*/
+static bool generate_file(const Bench_Case* const bench_case, const size_t file_size)
+{
+    char* const buffer = malloc(file_size);
+    if (buffer == NULL)
+    {
+        return false;
+    }
+
+    // fixed seed, so every run measures the same files
+    unsigned long long state = 0x9e3779b97f4a7c15ull;
+    size_t position = 0;
+
+    while (position < file_size)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        const size_t random = (size_t)(state >> 33);
+
+        const bool is_blank = random % 100 < bench_case->blank_percent;
+        const size_t line_length = is_blank == true ? 0 :
+            bench_case->min_line_length + random % (bench_case->max_line_length - bench_case->min_line_length + 1);
+
+        for (size_t i = 0; i < line_length && position < file_size; ++i)
+        {
+            buffer[position++] = (char)('a' + (random + i) % 26);
+        }
+
+        if (position < file_size)
+        {
+            buffer[position++] = '\n';
+        }
+    }
+
+    buffer[file_size - 1] = bench_case->has_trailing_new_line == true ? '\n' : 'z';
+
+    FILE* const file = fopen(bench_case->file_name, "w");
+    bool is_written = file != NULL && fwrite(buffer, 1, file_size, file) == file_size;
+
+    if (file != NULL)
+    {
+        is_written = fclose(file) == 0 && is_written;
+    }
+
+    free(buffer);
+
+    return is_written;
+}
+
+static bool describe_file(Bench_Case* const bench_case)
+{
+    File_Reader* const file_reader = file_reader_new(bench_case->file_name);
+    if (file_reader == NULL)
+    {
+        return false;
+    }
+
+    bench_case->file_size = file_reader_get_file_size(file_reader);
+    bench_case->no_of_lines = file_reader_get_no_of_lines(file_reader);
+    file_reader_delete(file_reader);
+
+    return bench_case->no_of_lines > 0;
+}
+
+static void run_case(const Bench_Case* const bench_case, const size_t repetitions, const bool is_last_case)
+{
+    const size_t no_of_operations = sizeof(bench_operations) / sizeof(bench_operations[0]);
+    double seconds[BENCH_MAX_REPETITIONS];
+
+    printf("    {\n      \"name\": \"%s\",\n      \"file\": \"%s\",\n      \"file_size\": %zu,\n      \"lines\": %zu,\n"
+           "      \"operations\": [\n",
+           bench_case->name, bench_case->file_name, bench_case->file_size, bench_case->no_of_lines);
+
+    for (size_t i = 0; i < no_of_operations; ++i)
+    {
+        const Bench_Operation* const operation = &bench_operations[i];
+        Allocation_Counter counter = {0, 0};
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.allocator = (File_Reader_Allocator){counting_allocate, counting_reallocate, counting_deallocate, &counter};
+
+        bool is_measured = true;
+        size_t no_of_allocations = 0;
+        size_t allocated_bytes = 0;
+
+        reset_peak_rss();
+
+        for (size_t repetition = 0; repetition < repetitions && is_measured == true; ++repetition)
+        {
+            counter = (Allocation_Counter){0, 0};
+            is_measured = operation->run(bench_case, &options, &seconds[repetition]);
+
+            // every repetition does the same, so the last one is reported
+            no_of_allocations = counter.no_of_allocations;
+            allocated_bytes = counter.allocated_bytes;
+        }
+
+        const long peak_rss_in_kb = read_peak_rss_in_kb();
+
+        printf("        {\"name\": \"%s\", ", operation->name);
+
+        if (is_measured == false)
+        {
+            printf("\"error\": true}%s\n", i + 1 < no_of_operations ? "," : "");
+            continue;
+        }
+
+        qsort(seconds, repetitions, sizeof(seconds[0]), compare_doubles);
+
+        const double median = percentile(seconds, repetitions, 0.5);
+
+        printf("\"seconds\": {\"min\": %.9f, \"median\": %.9f, \"p90\": %.9f, \"p99\": %.9f, \"max\": %.9f}, ",
+               seconds[0], median, percentile(seconds, repetitions, 0.9), percentile(seconds, repetitions, 0.99),
+               seconds[repetitions - 1]);
+        printf("\"mb_per_s\": %.2f, \"ns_per_line\": %.2f, ",
+               median > 0 ? (double)bench_case->file_size / 1e6 / median : 0.0,
+               median * 1e9 / (double)bench_case->no_of_lines);
+
+        if (operation->uses_allocator == true)
+        {
+            printf("\"allocations\": %zu, \"allocated_bytes\": %zu, ", no_of_allocations, allocated_bytes);
+        }
+        else
+        {
+            printf("\"allocations\": null, \"allocated_bytes\": null, ");
+        }
+
+        printf("\"peak_rss_kb\": %ld}%s\n", peak_rss_in_kb, i + 1 < no_of_operations ? "," : "");
+    }
+
+    printf("      ]\n    }%s\n", is_last_case == true ? "" : ",");
+    fflush(stdout);
+}
+
+static double now_in_seconds(void)
+{
+    struct timespec time_now;
+    clock_gettime(CLOCK_MONOTONIC, &time_now);
+
+    return (double)time_now.tv_sec + (double)time_now.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void* const first, const void* const second)
+{
+    const double first_value = *(const double*)first;
+    const double second_value = *(const double*)second;
+
+    return (first_value > second_value) - (first_value < second_value);
+}
+
+/*
+    Nearest-rank percentile of sorted values
+*/
+static double percentile(const double* const sorted_values, const size_t no_of_values, const double fraction)
+{
+    size_t rank = (size_t)(fraction * (double)no_of_values + 0.999999);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    return sorted_values[(rank < no_of_values ? rank : no_of_values) - 1];
+}
+
+/*
+    Peak RSS is reset, so it describes only the next operation. Without /proc/self/clear_refs
+    it stays the peak of the whole process.
+*/
+static void reset_peak_rss(void)
+{
+    FILE* const clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs != NULL)
+    {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+}
+
+static long read_peak_rss_in_kb(void)
+{
+    FILE* const status = fopen("/proc/self/status", "r");
+    char line[256];
+    long peak_rss_in_kb = -1;
+
+    while (status != NULL && fgets(line, sizeof(line), status) != NULL)
+    {
+        if (strncmp(line, "VmHWM:", 6) == 0)
+        {
+            peak_rss_in_kb = strtol(line + 6, NULL, 10);
+            break;
+        }
+    }
+
+    if (status != NULL)
+    {
+        fclose(status);
+    }
+
+    if (peak_rss_in_kb < 0)
+    {
+        struct rusage usage;
+        peak_rss_in_kb = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+    }
+
+    return peak_rss_in_kb;
+}
+
+static void* counting_allocate(void* const context, const size_t size)
+{
+    Allocation_Counter* const counter = context;
+    ++counter->no_of_allocations;
+    counter->allocated_bytes += size;
+
+    return malloc(size);
+}
+
+static void* counting_reallocate(void* const context, void* const memory, const size_t old_size, const size_t new_size)
+{
+    Allocation_Counter* const counter = context;
+    ++counter->no_of_allocations;
+    counter->allocated_bytes += new_size > old_size ? new_size - old_size : 0;
+
+    return realloc(memory, new_size);
+}
+
+static void counting_deallocate(void* const context, void* const memory)
+{
+    (void)context;
+    free(memory);
+}
+
+static bool run_new(const Bench_Case* const bench_case, const File_Reader_Options* const options, double* const seconds)
+{
+    const double begin = now_in_seconds();
+    File_Reader* const file_reader = file_reader_new_ex(bench_case->file_name, options);
+    *seconds = now_in_seconds() - begin;
+
+    file_reader_delete(file_reader);
+
+    return file_reader != NULL;
+}
+
+/*
+    Lines are counted by the stream, without loading the whole file
+*/
+static bool run_count_lines(const Bench_Case* const bench_case, const File_Reader_Options* const options,
+                            double* const seconds)
+{
+    (void)options;
+
+    const double begin = now_in_seconds();
+    File_Reader_Stream* const stream = file_reader_stream_open(bench_case->file_name, 0);
+    if (stream == NULL)
+    {
+        return false;
+    }
+
+    File_Reader_Line_View line;
+    size_t no_of_lines = 0;
+
+    while (file_reader_stream_next_line(stream, &line) == true)
+    {
+        ++no_of_lines;
+    }
+
+    const bool has_error = file_reader_stream_has_error(stream);
+    file_reader_stream_close(stream);
+    *seconds = now_in_seconds() - begin;
+
+    return has_error == false && no_of_lines > 0;
+}
+
+/*
+    Line index is built lazily by the first call which needs it
+*/
+static bool run_index_build(const Bench_Case* const bench_case, const File_Reader_Options* const options,
+                            double* const seconds)
+{
+    File_Reader* const file_reader = file_reader_new_ex(bench_case->file_name, options);
+    if (file_reader == NULL)
+    {
+        return false;
+    }
+
+    *(Allocation_Counter*)options->allocator.context = (Allocation_Counter){0, 0};
+
+    const double begin = now_in_seconds();
+    const size_t no_of_lines = file_reader_get_no_of_lines(file_reader);
+    *seconds = now_in_seconds() - begin;
+
+    file_reader_delete(file_reader);
+
+    return no_of_lines > 0;
+}
+
+static bool run_copy_of_each_line(const Bench_Case* const bench_case, const File_Reader_Options* const options,
+                                  double* const seconds)
+{
+    File_Reader* const file_reader = file_reader_new_ex(bench_case->file_name, options);
+    if (file_reader == NULL)
+    {
+        return false;
+    }
+
+    const size_t no_of_lines = file_reader_get_no_of_lines(file_reader);
+    size_t no_of_copies = 0;
+
+    // allocations of loading and indexing are not a part of this operation
+    *(Allocation_Counter*)options->allocator.context = (Allocation_Counter){0, 0};
+
+    const double begin = now_in_seconds();
+
+    for (size_t line = 1; line <= no_of_lines; ++line)
+    {
+        // empty lines have no copy
+        char* const line_buffer = file_reader_get_copy_of_line(file_reader, line);
+        no_of_copies += line_buffer != NULL;
+        file_reader_release_copy_of_line(file_reader, line_buffer);
+    }
+
+    *seconds = now_in_seconds() - begin;
+
+    file_reader_delete(file_reader);
+
+    return no_of_copies > 0;
+}
+
+static bool run_copy_of_file_buffer(const Bench_Case* const bench_case, const File_Reader_Options* const options,
+                                    double* const seconds)
+{
+    File_Reader* const file_reader = file_reader_new_ex(bench_case->file_name, options);
+    if (file_reader == NULL)
+    {
+        return false;
+    }
+
+    *(Allocation_Counter*)options->allocator.context = (Allocation_Counter){0, 0};
+
+    const double begin = now_in_seconds();
+    char* const copy_buffer = file_reader_get_copy_of_file_buffer(file_reader);
+    *seconds = now_in_seconds() - begin;
+
+    file_reader_release_copy_of_file_buffer(file_reader, copy_buffer);
+    file_reader_delete(file_reader);
+
+    return copy_buffer != NULL;
+}
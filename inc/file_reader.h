@@ -1,19 +1,250 @@
 #ifndef FILE_READER_H
 #define FILE_READER_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // forward declaration
 typedef struct File_Reader File_Reader;
+typedef struct File_Reader_Stream File_Reader_Stream;
+typedef struct File_Reader_Arena File_Reader_Arena;
+typedef struct File_Reader_Cache File_Reader_Cache;
+typedef struct File_Reader_Async File_Reader_Async;
+
+/*
+    Memory of reader (reader itself, buffer, line index, copies of lines and buffer)
+    comes from the allocator. Copies are released through the same allocator by
+    file_reader_release_copy_of_line and file_reader_release_copy_of_file_buffer,
+    the delete functions of copies are only for readers with the default allocator.
+    All three functions have to be set, allocator without functions means malloc, realloc and free,
+    reader is not created with only some of them.
+*/
+typedef struct File_Reader_Allocator
+{
+    void* (*allocate)(void* context, size_t size);
+    void* (*reallocate)(void* context, void* memory, size_t old_size, size_t new_size);
+    void  (*deallocate)(void* context, void* memory);
+    void*  context;
+} File_Reader_Allocator;
+
+typedef enum File_Reader_Index_Mode
+{
+    FILE_READER_INDEX_WIDE,     // size_t offset per line
+    FILE_READER_INDEX_COMPACT,  // 32-bit offsets, for files bigger than 4 GB relative to base of each 64 lines
+    FILE_READER_INDEX_DELTA     // 32-bit offsets relative to base of each 64 lines for files of any size
+} File_Reader_Index_Mode;
+
+typedef enum File_Reader_Index_Build
+{
+    FILE_READER_INDEX_BUILD_LAZY,         // whole index is built by the first call which needs lines
+    FILE_READER_INDEX_BUILD_EAGER,        // whole index is built when file is loaded
+    FILE_READER_INDEX_BUILD_INCREMENTAL   // file is scanned only as far as the requested line
+} File_Reader_Index_Build;
+
+// how regular files which are not mapped are read and what stays in page cache
+typedef enum File_Reader_Read_Mode
+{
+    FILE_READER_READ_CACHED,   // whole file at once through page cache, content stays cached
+    FILE_READER_READ_ONCE,     // sequential read-ahead, content is dropped from page cache after loading
+    FILE_READER_READ_DIRECT    // O_DIRECT in aligned blocks around page cache, cached read if file system refuses it
+} File_Reader_Read_Mode;
+
+typedef struct File_Reader_Options
+{
+    bool                  mapped;                  // map regular files into memory instead of copying them
+    bool                  decompress;              // decompress gzip/zstd files (if built with zlib/libzstd)
+    size_t                no_of_threads;           // threads used to build line index, 0 means number of online CPUs
+    size_t                parallel_threshold;      // files smaller than that (in bytes) are indexed by one thread
+    size_t                virtual_file_size_hint;  // expected size (in bytes) of virtual files, buffer grows from that
+    File_Reader_Allocator allocator;               // source of memory for reader, has to outlive the reader
+    File_Reader_Index_Mode index_mode;             // memory layout of line index
+    File_Reader_Index_Build index_build;           // when line index is built
+    bool                  line_index_file;         // keep line index of regular file in "<file name>.lidx"
+    File_Reader_Read_Mode read_mode;               // page cache policy of regular files
+    char                  kv_separator;            // index "key<separator>value" lines on each load, '\0' means no index
+    size_t                tail_no_of_lines;        // load only so many last lines of file, 0 means whole file
+} File_Reader_Options;
+
+typedef enum File_Reader_Follow_Result
+{
+    FILE_READER_FOLLOW_ERROR,      // file can't be read, reader is empty as after failed refresh
+    FILE_READER_FOLLOW_UNCHANGED,  // there is nothing new in file
+    FILE_READER_FOLLOW_APPENDED,   // new content was added after the previous one
+    FILE_READER_FOLLOW_RELOADED    // file was truncated or replaced, it was loaded again
+} File_Reader_Follow_Result;
+
+// view of a line inside of the reader buffer, valid as long as the reader exists
+typedef struct File_Reader_Line_View
+{
+    const char* data;  // first character of line, NULL for incorrect line
+    size_t      len;   // number of characters in line, the line is not terminated by '\0'
+} File_Reader_Line_View;
+
+typedef struct File_Reader_Match
+{
+    size_t line;    // number of line which contains the first character of match
+    size_t offset;  // offset of the first character of match in the file buffer
+} File_Reader_Match;
+
+// gets matches in order of their offsets, returning false stops the search
+typedef bool (*File_Reader_Match_Callback)(void* context, const File_Reader_Match* match);
+
+/*
+    Set of characters which separate fields of line, prepared once by file_reader_delimiters_init.
+    With collapse a run of delimiters is one separator and delimiters at both ends of line
+    are skipped (whitespace of /proc files), otherwise every delimiter ends a field (TSV).
+*/
+typedef struct File_Reader_Delimiters
+{
+    uint8_t is_delimiter[256];    // lookup table of all delimiters
+    char    characters[8];        // delimiters compared at once by vectorized scan
+    size_t  no_of_characters;     // 0 when there are more delimiters, only the table is used then
+    bool    collapse;
+} File_Reader_Delimiters;
+
+// gets fields of each line in order of lines, fields are valid as long as the reader exists, returning false stops
+typedef bool (*File_Reader_Fields_Callback)(void* context, size_t line, const File_Reader_Line_View* fields,
+                                            size_t no_of_fields);
+
+typedef enum File_Reader_Phase
+{
+    FILE_READER_PHASE_STAT,    // stat of file when reader is created or followed
+    FILE_READER_PHASE_PROBE,   // check if file is virtual or compressed
+    FILE_READER_PHASE_LOAD,    // reading, mapping or decompression of content
+    FILE_READER_PHASE_INDEX,   // building of line index
+    FILE_READER_NO_OF_PHASES
+} File_Reader_Phase;
+
+/*
+    Counters of reader (since it was created) or of all readers, available only when the library
+    is built with FILE_READER_WITH_STATS, otherwise they are compiled out.
+*/
+typedef struct File_Reader_Stats
+{
+    uint64_t bytes_read;              // bytes read from file or decompressed, mapped files are not read
+    uint64_t no_of_read_calls;        // read system calls
+    uint64_t no_of_read_retries;      // reads repeated after an error or a short read of regular file
+    uint64_t no_of_buffer_regrowths;  // buffer enlarged after it had some capacity
+    uint64_t no_of_allocations;       // allocations and reallocations through the allocator
+    uint64_t phase_time_in_ns[FILE_READER_NO_OF_PHASES];
+} File_Reader_Stats;
+
+// gets loaded reader (owned by callback) or NULL and errno of failure, e.g. ENOENT, ECANCELED
+typedef void (*File_Reader_Async_Callback)(void* user_data, File_Reader* file_reader, int error);
+
+typedef struct File_Reader_Cache_Stats
+{
+    uint64_t no_of_hits;        // acquires which got a cached reader
+    uint64_t no_of_misses;      // acquires which loaded the file
+    uint64_t no_of_evictions;   // readers without references deleted to fit into the budget
+    size_t   no_of_readers;     // readers in the cache now, acquired ones included
+    size_t   memory_in_bytes;   // memory of buffers and line indexes of these readers
+} File_Reader_Cache_Stats;
+
+typedef struct File_Reader_Trace_Event
+{
+    File_Reader_Phase phase;
+    const char*       file_name;
+    uint64_t          time_in_ns;     // duration of phase
+    bool              is_successful;
+} File_Reader_Trace_Event;
+
+// gets every finished phase of every reader, it can be called from many threads at once
+typedef void (*File_Reader_Trace_Callback)(void* context, const File_Reader_Trace_Event* event);
 
 File_Reader* file_reader_new(const char* file_name);
+File_Reader* file_reader_new_mapped(const char* file_name);
+void         file_reader_options_init(File_Reader_Options* options);
+File_Reader* file_reader_new_ex(const char* file_name, const File_Reader_Options* options);
+// file name relative to directory dir_fd (AT_FDCWD for current one), dir_fd has to stay open while reader is refreshed or followed
+File_Reader* file_reader_new_at(int dir_fd, const char* file_name, const File_Reader_Options* options);
+// only the last no_of_lines lines of file, regular file is read backwards from its end
+File_Reader* file_reader_tail(const char* file_name, size_t no_of_lines);
+bool         file_reader_refresh(File_Reader* file_reader);
+File_Reader_Follow_Result file_reader_follow(File_Reader* file_reader);
+bool         file_reader_follow_wait(const File_Reader* file_reader, int timeout_in_ms);
+size_t       file_reader_new_batch(const char* const* file_names, size_t no_of_files, File_Reader** file_readers,
+                                   int* errors);
 void         file_reader_delete(File_Reader* file_reader);
 size_t       file_reader_get_file_size(const File_Reader* file_reader);
+const char*  file_reader_get_file_name(const File_Reader* file_reader);
 size_t       file_reader_get_no_of_lines(const File_Reader* file_reader);
 const char*  file_reader_get_file_buffer(const File_Reader* file_reader);
 char*        file_reader_get_copy_of_file_buffer(const File_Reader* file_reader);
 void         file_reader_delete_copy_of_file_buffer(char* copy_buffer);
 char*        file_reader_get_copy_of_line(const File_Reader* file_reader, const size_t line);
 void         file_reader_delete_copy_of_line(char* line_buffer);
+void         file_reader_release_copy_of_file_buffer(const File_Reader* file_reader, char* copy_buffer);
+void         file_reader_release_copy_of_line(const File_Reader* file_reader, char* line_buffer);
+File_Reader_Line_View file_reader_get_line_view(const File_Reader* file_reader, size_t line);
+size_t       file_reader_get_line_views(const File_Reader* file_reader, size_t first_line,
+                                        size_t no_of_lines, File_Reader_Line_View* line_views);
+size_t       file_reader_get_line_index_size(const File_Reader* file_reader);
+size_t       file_reader_line_of_offset(const File_Reader* file_reader, size_t offset);
+File_Reader_Line_View file_reader_get_line_range(const File_Reader* file_reader, size_t first_line, size_t last_line);
+
+// search of needle in the whole file buffer, lines are not copied
+size_t       file_reader_find(const File_Reader* file_reader, const char* needle, size_t needle_length,
+                              File_Reader_Match* matches, size_t max_no_of_matches);
+size_t       file_reader_find_each(const File_Reader* file_reader, const char* needle, size_t needle_length,
+                                   File_Reader_Match_Callback callback, void* context);
+size_t       file_reader_find_parallel(const File_Reader* file_reader, const char* needle, size_t needle_length,
+                                       size_t no_of_threads, File_Reader_Match* matches, size_t max_no_of_matches);
+
+// fields of lines as views of the reader buffer, NULL delimiters mean collapsed whitespace;
+// fields over max_no_of_fields are not returned
+void         file_reader_delimiters_init(File_Reader_Delimiters* delimiters, const char* characters, bool collapse);
+size_t       file_reader_split_line(File_Reader_Line_View line_view, const File_Reader_Delimiters* delimiters,
+                                    File_Reader_Line_View* fields, size_t max_no_of_fields);
+size_t       file_reader_get_fields(const File_Reader* file_reader, size_t line, const File_Reader_Delimiters* delimiters,
+                                    File_Reader_Line_View* fields, size_t max_no_of_fields);
+size_t       file_reader_get_fields_each(const File_Reader* file_reader, size_t first_line, size_t no_of_lines,
+                                         const File_Reader_Delimiters* delimiters, File_Reader_Line_View* fields,
+                                         size_t max_no_of_fields, File_Reader_Fields_Callback callback, void* context);
+bool         file_reader_parse_uint(File_Reader_Line_View field, uint64_t* value);
+bool         file_reader_parse_int(File_Reader_Line_View field, int64_t* value);
+
+// values of "key<separator>value" lines, reader needs kv_separator in options
+File_Reader_Line_View file_reader_kv_get(const File_Reader* file_reader, const char* key);
+bool         file_reader_kv_get_uint(const File_Reader* file_reader, const char* key, uint64_t* value);
+bool         file_reader_kv_get_int(const File_Reader* file_reader, const char* key, int64_t* value);
+
+// statistics, functions return false and callback is never called when stats are compiled out
+bool         file_reader_get_stats(const File_Reader* file_reader, File_Reader_Stats* stats);
+bool         file_reader_get_global_stats(File_Reader_Stats* stats);
+void         file_reader_set_trace_callback(File_Reader_Trace_Callback callback, void* context);
+
+// streaming of file line by line through a buffer of bounded size, views are valid until the next call;
+// lines longer than max_line_length are returned in parts, each part but the last one is reported as truncated
+File_Reader_Stream* file_reader_stream_open(const char* file_name, size_t max_line_length);
+bool         file_reader_stream_next_line(File_Reader_Stream* stream, File_Reader_Line_View* line);
+bool         file_reader_stream_is_line_truncated(const File_Reader_Stream* stream);
+bool         file_reader_stream_has_error(const File_Reader_Stream* stream);
+void         file_reader_stream_close(File_Reader_Stream* stream);
+
+// shared immutable readers keyed by file name and validated by inode, size and mtime of the loaded file, thread safe;
+// readers without references are kept within the memory budget, the least recently used are evicted first;
+// readers are created and deleted by all threads which use the cache, so allocator of options has to be thread safe
+File_Reader_Cache*  file_reader_cache_new(size_t budget_in_bytes, const File_Reader_Options* options);
+const File_Reader*  file_reader_cache_acquire(File_Reader_Cache* cache, const char* file_name);
+void                file_reader_cache_release(File_Reader_Cache* cache, const File_Reader* file_reader);
+bool                file_reader_cache_get_stats(const File_Reader_Cache* cache, File_Reader_Cache_Stats* stats);
+void                file_reader_cache_delete(File_Reader_Cache* cache);
+
+// loading of files in background, callbacks are called by dispatch when fd is readable (fits epoll loop)
+File_Reader_Async*  file_reader_async_new(size_t no_of_threads, const File_Reader_Options* options);
+bool                file_reader_new_async(File_Reader_Async* async, const char* file_name,
+                                          File_Reader_Async_Callback callback, void* user_data);
+int                 file_reader_async_get_fd(const File_Reader_Async* async);
+size_t              file_reader_async_dispatch(File_Reader_Async* async);
+void                file_reader_async_delete(File_Reader_Async* async);
+
+// bump allocator, not thread safe; reset releases everything allocated from it at once,
+// readers are not valid after reset, mapped readers have to be deleted before to unmap the file
+File_Reader_Arena*    file_reader_arena_new(size_t block_size);
+File_Reader_Allocator file_reader_arena_get_allocator(File_Reader_Arena* arena);
+void                  file_reader_arena_reset(File_Reader_Arena* arena);
+void                  file_reader_arena_delete(File_Reader_Arena* arena);
 
 #endif // FILE_READER_H
\ No newline at end of file
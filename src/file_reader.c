@@ -1,33 +1,121 @@
+#define _GNU_SOURCE // O_DIRECT, MAP_ANONYMOUS, inotify_init1
+
 #include <file_reader.h>
+#include "file_reader_line_index.h"
+#include "file_reader_kv_index.h"
+#include "file_reader_allocator.h"
+#include "file_reader_decompressor.h"
+#include "file_reader_stats.h"
+#include "file_reader_identity.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
-#define VIRTUAL_FILE_BUFFER_IN_BYTES 2048
+#define DEFAULT_VIRTUAL_FILE_SIZE_HINT_IN_BYTES 2048
 #define MAX_NO_OF_READ_ATTEMPTS 10
+#define DEFAULT_PARALLEL_THRESHOLD_IN_BYTES (64 * 1024 * 1024)
+#define LINE_INDEX_FILE_SUFFIX ".lidx"
+// O_DIRECT needs buffer, size and offset of reads aligned to logical block size, page size suits all of them
+#define DIRECT_READ_ALIGNMENT 4096
+#define DIRECT_READ_BLOCK_SIZE_IN_BYTES (1024 * 1024)
+// tail of regular file is read backwards in such blocks
+#define TAIL_READ_BLOCK_SIZE_IN_BYTES (64 * 1024)
+// deflate can't compress more than that, size of content stored in compressed file is not trusted over it
+#define MAX_COMPRESSION_RATIO 1032
+
+typedef enum File_Kind
+{
+    FILE_KIND_NORMAL,   // regular file read to the buffer
+    FILE_KIND_VIRTUAL,  // file with unknown size (zero-size file e.g. in /proc, pipe) read to the buffer until EOF
+    FILE_KIND_MAPPED,   // regular file mapped into memory
+    FILE_KIND_COMPRESSED,  // compressed file decompressed to the buffer
+    FILE_KIND_TAIL      // last lines of regular file read backwards to the buffer
+} File_Kind;
 
 struct File_Reader
 {
-    const char* name;         // file name
-    size_t      no_of_lines;  // number of lines in file
-    size_t*     line_offset;  // buffer for lines offset e.g.: line_offset[1] indicates starting index of line 2
-    size_t      buffer_size;  // size of buffer (size of file + 1)
-    char        buffer[];     // buffer which stores file content extended by '\0' sign 
+    File_Kind           kind;             // how the file is loaded, found by each load from fstat of the file
+    Compression_Format  compression_format;   // format of compressed file, none for other kinds
+    File_Reader_Options options;          // options given when reader was created, used again by refresh
+    pthread_mutex_t     line_index_mutex; // serializes building of line index by concurrent callers
+    bool                is_line_index_built;  // whole line index is ready, accessed atomically
+    size_t              no_of_line_offsets;   // elements of line_offset found so far by incremental build
+    size_t              scanned_size;     // bytes of buffer scanned so far by incremental build
+    size_t              no_of_lines;      // number of lines in file, valid once line index is built
+    size_t*             line_offset;      // buffer for lines offset e.g.: line_offset[1] indicates starting index of line 2
+    size_t              line_offset_capacity; // number of allocated size_t elements of line_offset
+    Line_Index_Format   line_index_format;    // line_offset keeps size_t or compact offsets
+    size_t*             line_base;        // bases of blocks of lines for delta format of line_offset
+    size_t              line_index_mapping_size;  // line_offset is mapped from line index file, 0 if it is allocated
+    size_t              line_base_capacity;   // number of allocated elements of line_base
+    Kv_Index            kv_index;         // keys of "key<separator>value" lines, built by each load with kv_separator
+    size_t              buffer_size;      // size of buffer (size of file + 1)
+    size_t              buffer_capacity;  // number of allocated bytes of buffer, 0 if buffer is mapped
+    size_t              mapping_size;     // size of memory mapping which backs the buffer, 0 if buffer is not mapped
+    dev_t               file_device;      // identity of loaded regular file, follow loads the file again
+    ino_t               file_inode;       // when it is replaced by another one
+    struct timespec     file_mtime;       // modification time of loaded regular file, line index file has to match it
+    mode_t              file_mode;        // permission bits of loaded regular file, line index file gets them
+    off_t               file_stat_size;   // size of loaded file by fstat, content of e.g. compressed file differs
+    char*               buffer;           // buffer which stores file content extended by '\0' sign
+#ifdef FILE_READER_WITH_STATS
+    File_Reader_Stats   stats;            // counters of this reader, updated atomically
+    File_Reader_Allocator user_allocator; // allocator from options, options.allocator counts its allocations
+#endif
+    int                 dir_fd;           // directory of relative file name, AT_FDCWD means current directory
+    char                name[];           // copy of file name, file is read again by refresh
 };
 
 /***********************************************************
  * LOCAL FUNCTION DECLARATIONS
 ***********************************************************/
 
-static bool check_file_and_prepare_stats(const char* file_name, struct stat* file_stat_buffer);
-static bool is_file_virtual(const char* const file_name);
-static File_Reader* normal_file_reader_new(const char* file_name);
-static File_Reader* virtual_file_reader_new(const char* file_name);
-static size_t calculate_no_of_lines(const File_Reader* file_reader);
-static void file_reader_calculate_lines_offset(File_Reader* file_reader);
+static bool file_reader_load(File_Reader* file_reader);
+static int open_file(const File_Reader* file_reader);
+static bool classify_file(File_Reader* file_reader, int fd, const struct stat* file_stat_buffer);
+static void remember_file_identity(File_Reader* file_reader, const struct stat* file_stat_buffer);
+static void file_reader_drop_line_index(File_Reader* file_reader);
+static bool read_appended_bytes(File_Reader* file_reader, int fd, size_t new_file_size);
+static bool file_reader_extend_line_index(File_Reader* file_reader, size_t previous_file_size);
+static bool reserve_buffer(File_Reader* file_reader, size_t buffer_capacity);
+static void release_buffer(File_Reader* file_reader);
+static bool read_from_file(File_Reader* file_reader, int fd, char* buffer, size_t size, size_t* bytes_read_from_file);
+static bool read_direct_from_file(File_Reader* file_reader, int fd, char* buffer, size_t size,
+                                  size_t* bytes_read_from_file);
+static bool load_normal_file(File_Reader* file_reader, int fd, const struct stat* file_stat_buffer);
+static bool load_virtual_file(File_Reader* file_reader, int fd);
+static bool load_compressed_file(File_Reader* file_reader, int fd, const struct stat* file_stat_buffer);
+static bool load_mapped_file(File_Reader* file_reader, int fd, const struct stat* file_stat_buffer);
+static bool load_tail_of_file(File_Reader* file_reader, int fd, const struct stat* file_stat_buffer);
+static void keep_last_lines(File_Reader* file_reader);
+static bool file_reader_index_lines(File_Reader* file_reader, size_t line);
+static bool file_reader_index_keys(File_Reader* file_reader);
+static bool file_reader_update_line_index(File_Reader* file_reader, size_t line);
+static bool file_reader_ensure_line_index(File_Reader* file_reader);
+static bool file_reader_find_line(File_Reader* file_reader, size_t line, File_Reader_Line_View* line_view);
+static bool locate_line(const File_Reader* file_reader, size_t line, File_Reader_Line_View* line_view);
+static bool file_reader_build_line_index(File_Reader* file_reader);
+static bool file_reader_compact_line_index(File_Reader* file_reader);
+static bool file_reader_map_line_index_file(File_Reader* file_reader);
+static void file_reader_save_line_index_file(const File_Reader* file_reader);
+static char* get_path_name(const File_Reader* file_reader, const char* suffix);
 static size_t calculate_line_length(const File_Reader* file_reader, const size_t line);
+static inline size_t line_offset_at(const File_Reader* file_reader, size_t index);
+#ifdef FILE_READER_WITH_STATS
+static void* stats_allocate(void* file_reader, size_t size);
+static void* stats_reallocate(void* file_reader, void* memory, size_t old_size, size_t new_size);
+static void stats_deallocate(void* file_reader, void* memory);
+#endif
 
 
 /***********************************************************
@@ -36,495 +124,1753 @@ static size_t calculate_line_length(const File_Reader* file_reader, const size_t
 
 File_Reader* file_reader_new(const char* const file_name)
 {
-    if (file_name == NULL)
-    {
-        //printf("Icorrect file name: \"%s\"\n", file_name);
-        return NULL;
-    }
+    return file_reader_new_ex(file_name, NULL);
+}
 
-    File_Reader* file_reader = NULL;
+File_Reader* file_reader_new_mapped(const char* const file_name)
+{
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.mapped = true;
 
-    if (is_file_virtual(file_name) == true)
-    {
-        file_reader = virtual_file_reader_new(file_name);
-    }
-    else
-    {
-        file_reader = normal_file_reader_new(file_name);
-    }
+    return file_reader_new_ex(file_name, &options);
+}
 
-    if (file_reader != NULL && file_reader->buffer_size > 0)
+void file_reader_options_init(File_Reader_Options* const options)
+{
+    if (options == NULL)
     {
-        file_reader_calculate_lines_offset(file_reader);
+        return;
     }
 
-    return file_reader;    
+    options->mapped = false;
+    options->decompress = true;
+    options->no_of_threads = 0;
+    options->parallel_threshold = DEFAULT_PARALLEL_THRESHOLD_IN_BYTES;
+    options->virtual_file_size_hint = DEFAULT_VIRTUAL_FILE_SIZE_HINT_IN_BYTES;
+    options->allocator = (File_Reader_Allocator){NULL, NULL, NULL, NULL};
+    options->index_mode = FILE_READER_INDEX_WIDE;
+    options->index_build = FILE_READER_INDEX_BUILD_LAZY;
+    options->line_index_file = false;
+    options->read_mode = FILE_READER_READ_CACHED;
+    options->kv_separator = '\0';
+    options->tail_no_of_lines = 0;
 }
 
-void file_reader_delete(File_Reader* const file_reader)
+/*
+    Reader of the last no_of_lines lines of file, the rest of file is not read.
+    Lines are numbered from 1 in the reader, refresh and follow read the last lines again.
+*/
+File_Reader* file_reader_tail(const char* const file_name, const size_t no_of_lines)
 {
-    if (file_reader == NULL)
+    if (no_of_lines == 0)
     {
-        //printf("Can't delete file_reader pointed by NULL pointer\n");
-        return;
+        return NULL;
     }
 
-    if (file_reader->line_offset != NULL)
-    {
-        free(file_reader->line_offset);
-    }
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.tail_no_of_lines = no_of_lines;
 
-    free(file_reader);
+    return file_reader_new_ex(file_name, &options);
 }
 
-size_t file_reader_get_file_size(const File_Reader* const file_reader)
+File_Reader* file_reader_new_ex(const char* const file_name, const File_Reader_Options* const options)
 {
-    if (file_reader == NULL)
-    {
-        //printf("Can't open given file_reader\n");
-        return 0;
-    }
-
-    // size of file is smaller by 1 beacuse lack of '\0'
-    return file_reader->buffer_size - 1;
+    return file_reader_new_at(AT_FDCWD, file_name, options);
 }
 
-size_t file_reader_get_no_of_lines(const File_Reader* const file_reader)
+/*
+    File name is relative to directory dir_fd as for openat, so many files of one directory
+    are opened without resolving its path again. Reader keeps dir_fd to open the file again
+    (refresh, follow), it has to stay open as long as they are called.
+*/
+File_Reader* file_reader_new_at(const int dir_fd, const char* const file_name, const File_Reader_Options* const options)
 {
-    if (file_reader == NULL)
+    if (file_name == NULL)
     {
-        //printf("Can't open given file_reader\n");
-        return 0;       
+        //printf("Icorrect file name: \"%s\"\n", file_name);
+        return NULL;
     }
 
-    return file_reader->no_of_lines;
-}
+    File_Reader_Options default_options;
+    if (options == NULL)
+    {
+        file_reader_options_init(&default_options);
+    }
 
-const char* file_reader_get_file_buffer(const File_Reader* const file_reader)
-{
-    if (file_reader == NULL)
+    const File_Reader_Options* const used_options = options != NULL ? options : &default_options;
+    const size_t file_name_size = strlen(file_name) + 1;
+
+    // memory of partial allocator would be released by free
+    if (allocator_is_valid(&used_options->allocator) == false)
     {
-        //printf("Can't open given file_reader\n");
+        //printf("Incorrect allocator for file: \"%s\"\n", file_name);
         return NULL;
     }
 
-    return file_reader->buffer;
-}
-
-char* file_reader_get_copy_of_file_buffer(const File_Reader* const file_reader)
-{
+    File_Reader* const file_reader =
+        allocator_allocate_zeroed(&used_options->allocator, sizeof(*file_reader) + file_name_size);
     if (file_reader == NULL)
     {
-        //printf("Can't open given file_reader\n");
+        //printf("Can't create file reader instance for file: \"%s\"\n", file_name);
         return NULL;
     }
-    
-    char* copy_buffer = calloc(file_reader->buffer_size, sizeof(*copy_buffer));
 
-    if (copy_buffer == NULL)
+    if (pthread_mutex_init(&file_reader->line_index_mutex, NULL) != 0)
     {
-        //printf("Can't create copy_buffer\n");
+        //printf("Can't create file reader instance for file: \"%s\"\n", file_name);
+        allocator_deallocate(&used_options->allocator, file_reader);
         return NULL;
     }
 
-    memcpy(copy_buffer, file_reader->buffer, file_reader->buffer_size);
+    memcpy(file_reader->name, file_name, file_name_size);
+    file_reader->options = *used_options;
 
-    return copy_buffer;
-}
+#ifdef FILE_READER_WITH_STATS
+    // all memory of reader goes through the allocator, so it is counted there
+    file_reader->user_allocator = used_options->allocator;
+    file_reader->options.allocator = (File_Reader_Allocator){stats_allocate, stats_reallocate, stats_deallocate, file_reader};
+    STATS_ADD(&file_reader->stats, no_of_allocations, 1);
+#endif
 
-void file_reader_delete_copy_of_file_buffer(char* const copy_buffer)
-{
-    if (copy_buffer == NULL)
+    file_reader->dir_fd = dir_fd;
+
+    if (file_reader_load(file_reader) == false)
     {
-        //printf("Can't delete buffer pointed by NULL pointer\n");
-        return;
+        //printf("Can't load file: \"%s\"\n", file_name);
+        file_reader_delete(file_reader);
+        return NULL;
     }
 
-    free(copy_buffer);
+    return file_reader;    
 }
 
-static File_Reader* normal_file_reader_new(const char* const file_name)
+/*
+    Read the file again to the buffer and drop line index, it is built again as for a new reader.
+    Buffer and line index are reused and enlarged only when they are too small. If reading fails,
+    reader stays empty (no lines, size 0) until the next successful refresh.
+*/
+bool file_reader_refresh(File_Reader* const file_reader)
 {
-    struct stat file_stat_buffer = {0};
-    size_t read_attempts_counter = 0;
-
-    if (check_file_and_prepare_stats(file_name, &file_stat_buffer) == false)
+    if (file_reader == NULL)
     {
-        return NULL;
+        //printf("Can't open given file_reader\n");
+        return false;
     }
 
-    const size_t file_size_in_bytes = (size_t)file_stat_buffer.st_size;
-
-    if (file_size_in_bytes == 0)
+    if (file_reader_load(file_reader) == false)
     {
-        File_Reader* empty_file = NULL;
-        return empty_file;
+        //printf("Can't refresh file: \"%s\"\n", file_reader->name);
+        file_reader->buffer_size = 0;
+        return false;
     }
 
-    // buffer is extended by 1 becasue we need to add \0 at the end
-    const size_t buffer_size_in_bytes = file_size_in_bytes + 1;
+    return true;
+}
 
-    char* buffer = calloc(buffer_size_in_bytes, sizeof(*buffer));
-    if (buffer == NULL)
+/*
+    Check the file for new content. Bytes appended since the last load are read after
+    the content of buffer (mapped file is mapped again) and line index is continued
+    from the last line, so the cost depends only on the number of appended bytes.
+    File which is truncated or replaced by another one (e.g. rotated log) is loaded again,
+    virtual, compressed and tail files are always loaded again. As refresh, it can't be called while other threads use the reader.
+*/
+File_Reader_Follow_Result file_reader_follow(File_Reader* const file_reader)
+{
+    if (file_reader == NULL)
     {
-        //printf("Can't create buffer for normal file: \"%s\"\n", file_name);
-        return NULL;
+        //printf("Can't open given file_reader\n");
+        return FILE_READER_FOLLOW_ERROR;
     }
 
-    while (true)
+    // size of virtual file is unknown, compressed content can't be continued from the middle,
+    // tail keeps only the last lines, reader without content has nothing to continue
+    if (file_reader->kind == FILE_KIND_VIRTUAL || file_reader->kind == FILE_KIND_COMPRESSED
+        || file_reader->kind == FILE_KIND_TAIL || file_reader->buffer_size == 0)
     {
-        FILE* const normal_file = fopen(file_name, "r");
-        if (normal_file == NULL)
-        {
-            //printf("Can't open a normal file: \"%s\"\n", file_name);
-            free(buffer);
-            return NULL;
-        }
-
-        // read the file and copy the content of file to the buffer
-        const size_t bytes_read_from_file = 
-          fread(buffer, sizeof(buffer[0]), file_size_in_bytes, normal_file);
+        return file_reader_refresh(file_reader) == true ? FILE_READER_FOLLOW_RELOADED : FILE_READER_FOLLOW_ERROR;
+    }
 
-        // check if there is no error while perfoming operations on file
-        const bool has_error = ferror(normal_file);
+    STATS_PHASE_BEGIN(stat_begin);
+    const int fd = open_file(file_reader);
+    struct stat file_stat_buffer = {0};
+    const bool is_stat_known = fd != -1 && fstat(fd, &file_stat_buffer) == 0;
+    STATS_PHASE_END(&file_reader->stats, FILE_READER_PHASE_STAT, file_reader->name, stat_begin, is_stat_known);
 
-        // there will be no more operations on file so close it now
-        fclose(normal_file);
-    
-        /* if error occurs or bytes read from file are not equal the file size then
-           try again MAX_NO_OF_READ_ATTEMPTS times, if still error close function */
-        if (has_error == true || bytes_read_from_file != file_size_in_bytes)
+    if (is_stat_known == false)
+    {
+        //printf("Can't open followed file: \"%s\"\n", file_reader->name);
+        if (fd != -1)
         {
-            ++read_attempts_counter;
-            if (read_attempts_counter >= MAX_NO_OF_READ_ATTEMPTS)
-            {
-                //printf("Can't perform operations on file \"%s\"\n", file_name);
-                free(buffer);
-                return NULL;
-            }
-            else
-            {
-                // start at the beggining of the loop and try once again
-                continue;
-            }
+            close(fd);
         }
-
-        // if no error just leave the loop
-        break;
+        file_reader->buffer_size = 0;
+        return FILE_READER_FOLLOW_ERROR;
     }
 
-    // Add line termination at the end of buffer, -1 beacuse array starts with index 0
-    buffer[buffer_size_in_bytes - 1] = '\0';
+    const size_t file_size = file_reader->buffer_size - 1;
+    const size_t new_file_size = (size_t)file_stat_buffer.st_size;
+    const bool is_same_file = file_stat_buffer.st_dev == file_reader->file_device
+                              && file_stat_buffer.st_ino == file_reader->file_inode;
 
-    // create file reader instance based on buffer size and intialize
-    File_Reader* normal_file_reader =
-        calloc(1, sizeof(*normal_file_reader) + buffer_size_in_bytes);
-    
-    if (normal_file_reader == NULL)
+    if (is_same_file == false || new_file_size < file_size)
     {
-        //printf("Can't create file reader instance for normal file: \"%s\"\n", file_name);
-        free(buffer);
-        return NULL;
+        close(fd);
+        return file_reader_refresh(file_reader) == true ? FILE_READER_FOLLOW_RELOADED : FILE_READER_FOLLOW_ERROR;
     }
 
-    normal_file_reader->name = file_name;
-    normal_file_reader->buffer_size = buffer_size_in_bytes;
-    memcpy(normal_file_reader->buffer, buffer, buffer_size_in_bytes);
-    free(buffer);
-    normal_file_reader->no_of_lines = calculate_no_of_lines(normal_file_reader);
-    
-    return normal_file_reader;
-}
-
-static File_Reader* virtual_file_reader_new(const char* const file_name)
-{
-    char* buffer = calloc(VIRTUAL_FILE_BUFFER_IN_BYTES, sizeof(*buffer));
-    if (buffer == NULL)
+    if (new_file_size == file_size)
     {
-        //printf("Can't create buffer for virtual file: \"%s\"\n", file_name);
-        return NULL;
+        close(fd);
+        return FILE_READER_FOLLOW_UNCHANGED;
     }
 
-    size_t buffer_size_in_bytes = VIRTUAL_FILE_BUFFER_IN_BYTES;
-    size_t bytes_read_from_file = 0;
-    size_t read_attempts_counter = 0;
+    bool is_appended = false;
+    STATS_PHASE_BEGIN(load_begin);
 
-    while (true)
+    if (file_reader->kind == FILE_KIND_MAPPED)
     {
-        FILE* const virtual_file = fopen(file_name, "r");
-
-        if (virtual_file == NULL)
-        {
-            //printf("Can't open a virtual file: \"%s\"\n", file_name);
-            free(buffer);
-            return NULL;
-        }
-
-        // read the file, copy the content of file to buffer and return amount of read bytes
-        bytes_read_from_file = 
-          fread(buffer, sizeof(buffer[0]), buffer_size_in_bytes, virtual_file);
-
-        // check if read file has EOF sign
-        const bool has_eof = feof(virtual_file);
-
-        // check if there is no error while perfoming operations on file
-        const bool has_error = ferror(virtual_file);
-
-        // there will be no more operations on file so close it now
-        fclose(virtual_file);
-
-        // if error occurs try again MAX_NO_OF_READ_ATTEMPTS times, if still error close function
-        if (has_error == true)
-        {
-            ++read_attempts_counter;
-            if (read_attempts_counter >= MAX_NO_OF_READ_ATTEMPTS)
-            {
-                //printf("Can't perform operations on file \"%s\"\n", file_name);
-                free(buffer);
-                return NULL;
-            }
-            else
-            {
-                // start at the beggining of the loop and try once again
-                continue;
-            }
-        }
-
-        // if read bytes don't excced buffer and file has eof just leave the loop
-        if (bytes_read_from_file < buffer_size_in_bytes && has_eof)
-        {
-            break;
-        }
-
-        /* If previous statement is not true, it means that the buffer were too small.
-           So realease old buffer and create new one with doubled size.
-        */
-        //printf("Buffer size (%ld bytes) was too small, double the size of buffer \n", buffer_size_in_bytes);
-        free(buffer);
-        buffer_size_in_bytes = buffer_size_in_bytes * 2;
-        buffer = calloc(buffer_size_in_bytes, sizeof(*buffer));
-        if (buffer == NULL)
-        {
-            //printf("Can't create buffer for virtual file: \"%s\"\n", file_name);
-            return NULL;
-        }
+        // pages of the previous content are not read again, they are only mapped
+        is_appended = load_mapped_file(file_reader, fd, &file_stat_buffer);
+    }
+    else
+    {
+        is_appended = read_appended_bytes(file_reader, fd, new_file_size);
     }
 
-    // add space for '\0' sign
-    const size_t file_reader_buffer_size = bytes_read_from_file + 1;
-    buffer[file_reader_buffer_size - 1] = '\0';
+    remember_file_identity(file_reader, &file_stat_buffer);
+    close(fd);
 
-    // create file reader instance based on buffer size and intialize
-    File_Reader* virtual_file_reader =
-        calloc(1, sizeof(*virtual_file_reader) + file_reader_buffer_size);
-    
-    if (virtual_file_reader == NULL)
+    STATS_PHASE_END(&file_reader->stats, FILE_READER_PHASE_LOAD, file_reader->name, load_begin, is_appended);
+
+    // appended content can finish the value of the last line, so keys are indexed again
+    if (is_appended == false || file_reader_extend_line_index(file_reader, file_size) == false
+        || file_reader_index_keys(file_reader) == false)
     {
-        //printf("Can't create file reader instance for virtual file: \"%s\"\n", file_name);
-        free(buffer);
-        return NULL;
+        //printf("Can't read appended content of file: \"%s\"\n", file_reader->name);
+        file_reader->buffer_size = 0;
+        return FILE_READER_FOLLOW_ERROR;
     }
 
-    virtual_file_reader->name = file_name;
-    virtual_file_reader->buffer_size = file_reader_buffer_size;
-    memcpy(virtual_file_reader->buffer, buffer, file_reader_buffer_size);
-    free(buffer);
-    virtual_file_reader->no_of_lines = calculate_no_of_lines(virtual_file_reader);
-    
-    return virtual_file_reader;
+    return file_reader->buffer_size - 1 > file_size ? FILE_READER_FOLLOW_APPENDED : FILE_READER_FOLLOW_UNCHANGED;
 }
 
 /*
-    Verify if given file name is not null and fetch file stats for given file
+    Block until the file is modified, moved or deleted, or until timeout_in_ms passes
+    (-1 means no timeout). Returns at once if the file differs from the content of reader already.
+    Returns false on timeout or when the file can't be watched.
 */
-static bool check_file_and_prepare_stats(const char* const file_name, struct stat* const file_stat_buffer)
+bool file_reader_follow_wait(const File_Reader* const file_reader, const int timeout_in_ms)
 {
-    if (file_name == NULL)
+    if (file_reader == NULL)
     {
-        //printf("Icorrect file name: \"%s\"\n", file_name);
+        //printf("Can't open given file_reader\n");
         return false;
     }
 
-    if (stat(file_name, file_stat_buffer) == -1)
+    const int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd == -1)
     {
-        //printf("Could not fetch file stats correctly for file \"%s\"\n", file_name);
         return false;
     }
 
-    return true;
-}
-
-static bool is_file_virtual(const char* const file_name)
-{
-    struct stat file_stat_buffer = {0};
+    // inotify has no variant relative to directory descriptor
+    char* const path_name = get_path_name(file_reader, "");
+    const uint32_t watched_events = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
 
-    if (check_file_and_prepare_stats(file_name, &file_stat_buffer) == false)
+    if (path_name == NULL || inotify_add_watch(inotify_fd, path_name, watched_events) == -1)
     {
+        //printf("Can't watch file: \"%s\"\n", file_reader->name);
+        free(path_name);
+        close(inotify_fd);
         return false;
     }
 
-    // virtual files have size which equals 0
-    if (file_stat_buffer.st_size != 0)
-    {
-        return false;
-    }
+    // file is checked after the watch is added, so a change made before can't be missed
+    struct stat file_stat_buffer = {0};
+    const int stat_result = stat(path_name, &file_stat_buffer);
+    free(path_name);
 
-    FILE* file = fopen(file_name, "r");
-    if (file == NULL)
+    const bool is_changed = stat_result == -1
+                            || file_stat_buffer.st_dev != file_reader->file_device
+                            || file_stat_buffer.st_ino != file_reader->file_inode
+                            || (size_t)file_stat_buffer.st_size + 1 != file_reader->buffer_size;
+
+    bool has_event = false;
+
+    if (is_changed == false)
     {
-        //printf("Could not open given file \"%s\"\n", file_name);
-        return false;
-    }
+        struct pollfd watched_fd = {inotify_fd, POLLIN, 0};
+        int poll_result = 0;
 
-    enum {TEMP_BUFFER_SIZE = 1};
-    char temp_buffer[TEMP_BUFFER_SIZE] = {'0'};
-    const size_t no_of_elements_read = fread(temp_buffer, sizeof(temp_buffer[0]), TEMP_BUFFER_SIZE, file);
+        do
+        {
+            poll_result = poll(&watched_fd, 1, timeout_in_ms);
+        } while (poll_result == -1 && errno == EINTR);
 
-    /*
-        Check if despites of zero size file, we got an element to read,
-        Which is also not the EOF sign. 
-    */
-    const bool lack_of_eof_in_temp_buffer = !feof(file);
-    const bool is_virtual = no_of_elements_read && lack_of_eof_in_temp_buffer;
+        has_event = poll_result > 0;
+    }
 
-    fclose(file);
+    close(inotify_fd);
 
-    return is_virtual;
+    return is_changed == true || has_event == true;
 }
 
-static size_t calculate_no_of_lines(const File_Reader* const file_reader)
+void file_reader_delete(File_Reader* const file_reader)
 {
     if (file_reader == NULL)
     {
-        //printf("Can't open file_reader\n");
-        return 0;
+        //printf("Can't delete file_reader pointed by NULL pointer\n");
+        return;
     }
 
-    // proceed empty file
-    if (file_reader->buffer_size == 0)
+    // reader itself is released through the allocator as the last one
+    const File_Reader_Allocator allocator = file_reader->options.allocator;
+
+    if (file_reader->line_index_mapping_size > 0)
     {
-        return 0;
+        line_index_file_unmap(file_reader->line_offset, file_reader->line_index_mapping_size);
     }
-
-    // if file exist there is at least one line
-    size_t line_counter = 1;
-    const char* ptr = file_reader->buffer;
-    const char* ptr_to_last_elem = file_reader->buffer + file_reader->buffer_size;
-
-   /* don't check last two elements since buffer always ends with \n
-      and if last line of file ends with \n it means that there is no more lines
-   */
-   while (ptr < ptr_to_last_elem - 2) 
+    else if (file_reader->line_offset != NULL)
     {
-        if (*ptr == '\n')
-        {
-            ++line_counter;
-        }
-        ++ptr;
+        allocator_deallocate(&allocator, file_reader->line_offset);
     }
- 
-    return line_counter;
-}
 
-static void file_reader_calculate_lines_offset(File_Reader* const file_reader)
-{
-    if (file_reader == NULL)
+    if (file_reader->line_base != NULL)
     {
-        //printf("Can't open file_reader\n");
-        return;
+        allocator_deallocate(&allocator, file_reader->line_base);
     }
 
-    // allocate an extra element for the line_offset to mark the end of the array
-    file_reader->line_offset =
-        calloc(file_reader->no_of_lines + 1, sizeof(*file_reader->line_offset));
-
-    char* current_position = file_reader->buffer;
-    char* next_position = strchr(current_position, '\n');
-    size_t current_line = 0;
-    file_reader->line_offset[current_line] = 0;
+    kv_index_release(&file_reader->kv_index, &allocator);
 
-    while (next_position != NULL)
+    if (file_reader->mapping_size > 0)
+    {
+        munmap(file_reader->buffer, file_reader->mapping_size);
+    }
+    else if (file_reader->buffer_capacity > 0)
     {
-        current_position = next_position + 1;
-        next_position = strchr(current_position, '\n');
-        ++current_line;
-        file_reader->line_offset[current_line] = (size_t)(current_position - file_reader->buffer);
+        allocator_deallocate(&allocator, file_reader->buffer);
     }
+
+    pthread_mutex_destroy(&file_reader->line_index_mutex);
+    allocator_deallocate(&allocator, file_reader);
 }
 
-static size_t calculate_line_length(const File_Reader* const file_reader, const size_t line)
+size_t file_reader_get_file_size(const File_Reader* const file_reader)
 {
     if (file_reader == NULL)
     {
+        //printf("Can't open given file_reader\n");
         return 0;
     }
 
-    if (line > file_reader->no_of_lines || line < 1)
+    // reader without content, e.g. after failed refresh
+    if (file_reader->buffer_size == 0)
     {
-        //printf("Incorrect line number to get\n");
         return 0;
     }
 
-    size_t line_length = 0;
-
-    /*
-        Example of line_lenght calculation:
-            line 1: ab     offset[1] = 3
-            line 2: cd     offset[2] = 6
-            line 3: efg    offset[3] = 10
-            line 4: h      offset[4] = 12
-            line 5: ij     buffer_size = file_size + 1 = 14 + 1 = 15
+    // size of file is smaller by 1 beacuse lack of '\0'
+    return file_reader->buffer_size - 1;
+}
 
-            line_length(3) = 10(offset[3]) - 6(offset[2]) - 1(character \0) = 3
-            line_length(5) = 15(buffer size) - 12(offset[4]) - 1(character \0) = 2
-    */
-    if (line != file_reader->no_of_lines)
+/*
+    File name as it was given when reader was created, relative to its directory
+*/
+const char* file_reader_get_file_name(const File_Reader* const file_reader)
+{
+    if (file_reader == NULL)
     {
-        line_length = file_reader->line_offset[line] - file_reader->line_offset[line - 1] - 1;
+        //printf("Can't open given file_reader\n");
+        return NULL;
     }
-    else
+
+    return file_reader->name;
+}
+
+/*
+    File as it was when its content was loaded (internal, for the cache),
+    a reader which failed to load has no identity
+*/
+bool file_reader_get_identity(const File_Reader* const file_reader, File_Identity* const identity)
+{
+    if (file_reader == NULL || identity == NULL || file_reader->buffer_size == 0)
     {
-        line_length = file_reader->buffer_size - file_reader->line_offset[line - 1] - 1;
+        return false;
     }
 
-    return line_length;
+    identity->device = file_reader->file_device;
+    identity->inode = file_reader->file_inode;
+    identity->mode = file_reader->file_mode;
+    identity->size = file_reader->file_stat_size;
+    identity->mtime = file_reader->file_mtime;
+
+    return true;
 }
 
-char* file_reader_get_copy_of_line(const File_Reader* const file_reader, const size_t line)
+size_t file_reader_get_no_of_lines(const File_Reader* const file_reader)
 {
     if (file_reader == NULL)
     {
         //printf("Can't open given file_reader\n");
-        return NULL;
+        return 0;       
     }
 
     if (file_reader->buffer_size == 0)
     {
-        //printf("Size of file_reader buffer content is 0\n");
-        return NULL;
+        return 0;
     }
 
-    const size_t line_length = calculate_line_length(file_reader, line);
+    // line index is built on demand, it doesn't change anything what the caller can see
+    File_Reader* const indexed_reader = (File_Reader*)file_reader;
 
-    if (line_length == 0)
+    if (file_reader_ensure_line_index(indexed_reader) == false)
     {
-        return NULL;
+        //printf("Can't build line index for file: \"%s\"\n", file_reader->name);
+        return 0;
     }
 
-    // create buffer for specified line, add +1 for '\0' sign
-    char* line_buffer = calloc(line_length + 1, sizeof(*line_buffer));
-    if (line_buffer == NULL)
+    return indexed_reader->no_of_lines;
+}
+
+const char* file_reader_get_file_buffer(const File_Reader* const file_reader)
+{
+    if (file_reader == NULL || file_reader->buffer_size == 0)
     {
+        //printf("Can't open given file_reader\n");
         return NULL;
     }
 
-    // copy content of line to new buffer
-    memcpy(line_buffer, 
-           &file_reader->buffer[file_reader->line_offset[line - 1]],
-           line_length);
-    
-    // add null termination at the end of string
-    line_buffer[line_length] = '\0';
+    return file_reader->buffer;
+}
+
+char* file_reader_get_copy_of_file_buffer(const File_Reader* const file_reader)
+{
+    if (file_reader == NULL || file_reader->buffer_size == 0)
+    {
+        //printf("Can't open given file_reader\n");
+        return NULL;
+    }
+    
+    char* copy_buffer = allocator_allocate(&file_reader->options.allocator, file_reader->buffer_size);
+
+    if (copy_buffer == NULL)
+    {
+        //printf("Can't create copy_buffer\n");
+        return NULL;
+    }
+
+    memcpy(copy_buffer, file_reader->buffer, file_reader->buffer_size);
+
+    return copy_buffer;
+}
+
+void file_reader_delete_copy_of_file_buffer(char* const copy_buffer)
+{
+    if (copy_buffer == NULL)
+    {
+        //printf("Can't delete buffer pointed by NULL pointer\n");
+        return;
+    }
+
+    free(copy_buffer);
+}
+
+/*
+    Open the file once, find its kind from fstat of the descriptor and load the content from it,
+    so metadata is not fetched again and the size can't change between stat and read.
+    Line index is built at once only in eager mode.
+*/
+static bool file_reader_load(File_Reader* const file_reader)
+{
+    bool is_loaded = false;
+
+    file_reader_drop_line_index(file_reader);
+    kv_index_clear(&file_reader->kv_index);
+
+    STATS_PHASE_BEGIN(stat_begin);
+    const int fd = open_file(file_reader);
+    struct stat file_stat_buffer = {0};
+    const bool is_stat_known = fd != -1 && fstat(fd, &file_stat_buffer) == 0;
+    STATS_PHASE_END(&file_reader->stats, FILE_READER_PHASE_STAT, file_reader->name, stat_begin, is_stat_known);
+
+    if (is_stat_known == false)
+    {
+        //printf("Can't open file: \"%s\"\n", file_reader->name);
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    STATS_PHASE_BEGIN(probe_begin);
+    const bool is_classified = classify_file(file_reader, fd, &file_stat_buffer);
+    STATS_PHASE_END(&file_reader->stats, FILE_READER_PHASE_PROBE, file_reader->name, probe_begin, is_classified);
+
+    if (is_classified == false)
+    {
+        //printf("Can't read file which is not a regular file or a pipe: \"%s\"\n", file_reader->name);
+        close(fd);
+        return false;
+    }
+
+    remember_file_identity(file_reader, &file_stat_buffer);
+
+    // kind of file can change between loads, mapped buffer can't be reused as allocated one and vice versa
+    if ((file_reader->mapping_size > 0) != (file_reader->kind == FILE_KIND_MAPPED))
+    {
+        release_buffer(file_reader);
+    }
+
+    STATS_PHASE_BEGIN(load_begin);
+
+    switch (file_reader->kind)
+    {
+        case FILE_KIND_VIRTUAL:
+            is_loaded = load_virtual_file(file_reader, fd);
+            break;
+        case FILE_KIND_MAPPED:
+            is_loaded = load_mapped_file(file_reader, fd, &file_stat_buffer);
+            break;
+        case FILE_KIND_COMPRESSED:
+            is_loaded = load_compressed_file(file_reader, fd, &file_stat_buffer);
+            break;
+        case FILE_KIND_TAIL:
+            is_loaded = load_tail_of_file(file_reader, fd, &file_stat_buffer);
+            break;
+        case FILE_KIND_NORMAL:
+        default:
+            is_loaded = load_normal_file(file_reader, fd, &file_stat_buffer);
+            break;
+    }
+
+    close(fd);
+
+    STATS_PHASE_END(&file_reader->stats, FILE_READER_PHASE_LOAD, file_reader->name, load_begin, is_loaded);
+
+    if (is_loaded == false)
+    {
+        return false;
+    }
+
+    // content of unknown size can't be read backwards, so its first lines are dropped after loading
+    if (file_reader->options.tail_no_of_lines > 0 && file_reader->kind != FILE_KIND_TAIL)
+    {
+        keep_last_lines(file_reader);
+    }
+
+    if (file_reader_index_keys(file_reader) == false)
+    {
+        return false;
+    }
+
+    // reader is not shared with other threads yet, so there is no need to lock
+    if (file_reader->options.index_build == FILE_READER_INDEX_BUILD_EAGER)
+    {
+        return file_reader_index_lines(file_reader, SIZE_MAX);
+    }
+
+    return true;
+}
+
+static int open_file(const File_Reader* const file_reader)
+{
+    return openat(file_reader->dir_fd, file_reader->name, O_RDONLY | O_CLOEXEC);
+}
+
+/*
+    Regular files are read or mapped, compressed ones are decompressed. Files in /proc and /sys
+    report size 0 and pipes have no size at all, so both are read until EOF.
+    Other files (directories, devices) are not read.
+*/
+static bool classify_file(File_Reader* const file_reader, const int fd, const struct stat* const file_stat_buffer)
+{
+    file_reader->compression_format = COMPRESSION_FORMAT_NONE;
+
+    if (S_ISFIFO(file_stat_buffer->st_mode))
+    {
+        file_reader->kind = FILE_KIND_VIRTUAL;
+        return true;
+    }
+
+    if (!S_ISREG(file_stat_buffer->st_mode))
+    {
+        return false;
+    }
+
+    // virtual files can't be mapped, they are always read into the buffer
+    if (file_stat_buffer->st_size == 0)
+    {
+        file_reader->kind = FILE_KIND_VIRTUAL;
+    }
+    else if (file_reader->options.decompress == true
+             && (file_reader->compression_format = compression_detect_format(fd)) != COMPRESSION_FORMAT_NONE)
+    {
+        file_reader->kind = FILE_KIND_COMPRESSED;
+    }
+    else if (file_reader->options.tail_no_of_lines > 0)
+    {
+        file_reader->kind = FILE_KIND_TAIL;
+    }
+    else if (file_reader->options.mapped == true)
+    {
+        file_reader->kind = FILE_KIND_MAPPED;
+    }
+    else
+    {
+        file_reader->kind = FILE_KIND_NORMAL;
+    }
+
+    return true;
+}
+
+/*
+    Follow loads the file again when it is replaced by another one,
+    line index file has to match the modification time
+*/
+static void remember_file_identity(File_Reader* const file_reader, const struct stat* const file_stat_buffer)
+{
+    file_reader->file_device = file_stat_buffer->st_dev;
+    file_reader->file_inode = file_stat_buffer->st_ino;
+    file_reader->file_mtime = file_stat_buffer->st_mtim;
+    file_reader->file_mode = file_stat_buffer->st_mode;
+    file_reader->file_stat_size = file_stat_buffer->st_size;
+}
+
+/*
+    Key/value index is built only when it is asked for by options, whole buffer is scanned once
+*/
+static bool file_reader_index_keys(File_Reader* const file_reader)
+{
+    if (file_reader->options.kv_separator == '\0')
+    {
+        return true;
+    }
+
+    return kv_index_build(&file_reader->kv_index, file_reader->buffer, file_reader->buffer_size - 1,
+                          file_reader->options.kv_separator, &file_reader->options.allocator);
+}
+
+/*
+    Forget line index of previous content, memory of index is kept for the next one.
+    Offsets are always built as size_t ones, also when index was compact.
+*/
+static void file_reader_drop_line_index(File_Reader* const file_reader)
+{
+    // mapped index belongs to the line index file, it can't be reused
+    if (file_reader->line_index_mapping_size > 0)
+    {
+        line_index_file_unmap(file_reader->line_offset, file_reader->line_index_mapping_size);
+        file_reader->line_index_mapping_size = 0;
+        file_reader->line_offset = NULL;
+        file_reader->line_offset_capacity = 0;
+    }
+
+    __atomic_store_n(&file_reader->is_line_index_built, false, __ATOMIC_RELAXED);
+    file_reader->line_index_format = LINE_INDEX_FORMAT_WIDE;
+    file_reader->no_of_line_offsets = 0;
+    file_reader->scanned_size = 0;
+    file_reader->no_of_lines = 0;
+}
+
+/*
+    Read bytes which were appended to the file after the content of buffer.
+    Buffer grows at least twice, so many small appends don't copy the whole buffer each time.
+*/
+static bool read_appended_bytes(File_Reader* const file_reader, const int fd, const size_t new_file_size)
+{
+    const size_t file_size = file_reader->buffer_size - 1;
+    const size_t doubled_capacity = file_reader->buffer_capacity * 2;
+    const size_t buffer_capacity = new_file_size + 1 > doubled_capacity ? new_file_size + 1 : doubled_capacity;
+
+    if (new_file_size + 1 > file_reader->buffer_capacity && reserve_buffer(file_reader, buffer_capacity) == false)
+    {
+        return false;
+    }
+
+    if (lseek(fd, (off_t)file_size, SEEK_SET) == -1)
+    {
+        return false;
+    }
+
+    // file may be truncated meanwhile, then only bytes which are still there are taken
+    size_t bytes_read_from_file = 0;
+    if (read_from_file(file_reader, fd, file_reader->buffer + file_size, new_file_size - file_size,
+                       &bytes_read_from_file) == false)
+    {
+        return false;
+    }
+
+    file_reader->buffer_size = file_size + bytes_read_from_file + 1;
+    file_reader->buffer[file_reader->buffer_size - 1] = '\0';
+
+    return true;
+}
+
+/*
+    Complete line index ends with the end marker, it is removed and scanning continues after
+    previous content. '\n' at the end of previous content starts a line now, so its offset stays.
+    Compact and mapped indexes can't be continued, they are built again. Index which is not complete
+    (lazy one not built yet, incremental one) continues from where it stopped anyway.
+*/
+static bool file_reader_extend_line_index(File_Reader* const file_reader, const size_t previous_file_size)
+{
+    if (__atomic_load_n(&file_reader->is_line_index_built, __ATOMIC_RELAXED) == true)
+    {
+        if (file_reader->line_index_format != LINE_INDEX_FORMAT_WIDE || file_reader->line_index_mapping_size > 0)
+        {
+            file_reader_drop_line_index(file_reader);
+        }
+        else
+        {
+            const bool had_trailing_new_line = file_reader->buffer[previous_file_size - 1] == '\n';
+
+            file_reader->no_of_line_offsets = file_reader->no_of_lines + (had_trailing_new_line == true ? 1 : 0);
+            file_reader->scanned_size = previous_file_size;
+            __atomic_store_n(&file_reader->is_line_index_built, false, __ATOMIC_RELAXED);
+        }
+    }
+
+    // reader is not shared with other threads while it follows the file, so there is no need to lock
+    if (file_reader->options.index_build == FILE_READER_INDEX_BUILD_EAGER)
+    {
+        return file_reader_index_lines(file_reader, SIZE_MAX);
+    }
+
+    return true;
+}
+
+/*
+    Make sure that the buffer has at least buffer_capacity bytes, content of buffer is kept
+*/
+static bool reserve_buffer(File_Reader* const file_reader, const size_t buffer_capacity)
+{
+    if (buffer_capacity <= file_reader->buffer_capacity)
+    {
+        return true;
+    }
+
+    char* const buffer = allocator_reallocate(&file_reader->options.allocator,
+                                              file_reader->buffer_capacity > 0 ? file_reader->buffer : NULL,
+                                              file_reader->buffer_capacity,
+                                              buffer_capacity);
+    if (buffer == NULL)
+    {
+        //printf("Can't enlarge buffer for file: \"%s\"\n", file_reader->name);
+        return false;
+    }
+
+    if (file_reader->buffer_capacity > 0)
+    {
+        STATS_ADD(&file_reader->stats, no_of_buffer_regrowths, 1);
+    }
+
+    file_reader->buffer = buffer;
+    file_reader->buffer_capacity = buffer_capacity;
+
+    return true;
+}
+
+static void release_buffer(File_Reader* const file_reader)
+{
+    if (file_reader->mapping_size > 0)
+    {
+        munmap(file_reader->buffer, file_reader->mapping_size);
+    }
+    else if (file_reader->buffer_capacity > 0)
+    {
+        allocator_deallocate(&file_reader->options.allocator, file_reader->buffer);
+    }
+
+    file_reader->buffer = NULL;
+    file_reader->buffer_capacity = 0;
+    file_reader->buffer_size = 0;
+    file_reader->mapping_size = 0;
+}
+
+/*
+    Read up to size bytes, stops earlier only at the end of file or on error
+*/
+static bool read_from_file(File_Reader* const file_reader, const int fd, char* const buffer, const size_t size,
+                           size_t* const bytes_read_from_file)
+{
+    // reader is used only by stats
+    (void)file_reader;
+
+    size_t read_attempts_counter = 0;
+    *bytes_read_from_file = 0;
+
+    while (*bytes_read_from_file < size)
+    {
+        const ssize_t bytes_read =
+            read(fd, buffer + *bytes_read_from_file, size - *bytes_read_from_file);
+        STATS_ADD(&file_reader->stats, no_of_read_calls, 1);
+
+        /* interrupted read is just repeated, if other error occurs try again
+           MAX_NO_OF_READ_ATTEMPTS times, if still error close function */
+        if (bytes_read == -1)
+        {
+            if (errno != EINTR)
+            {
+                ++read_attempts_counter;
+                if (read_attempts_counter >= MAX_NO_OF_READ_ATTEMPTS)
+                {
+                    return false;
+                }
+            }
+
+            STATS_ADD(&file_reader->stats, no_of_read_retries, 1);
+            continue;
+        }
+
+        // no more content
+        if (bytes_read == 0)
+        {
+            break;
+        }
+
+        *bytes_read_from_file += (size_t)bytes_read;
+        STATS_ADD(&file_reader->stats, bytes_read, bytes_read);
+    }
+
+    return true;
+}
+
+/*
+    O_DIRECT reads go to a small aligned block which is copied to the buffer, as buffer of reader
+    comes from the allocator which doesn't align it. If the file system doesn't support O_DIRECT
+    (open or read fails with EINVAL), the rest of file is read through page cache.
+*/
+static bool read_direct_from_file(File_Reader* const file_reader, const int fd, char* const buffer, const size_t size,
+                                  size_t* const bytes_read_from_file)
+{
+    void* block = NULL;
+    *bytes_read_from_file = 0;
+
+    if (posix_memalign(&block, DIRECT_READ_ALIGNMENT, DIRECT_READ_BLOCK_SIZE_IN_BYTES) != 0)
+    {
+        block = NULL;
+    }
+
+    while (block != NULL && *bytes_read_from_file < size)
+    {
+        const ssize_t bytes_read = read(fd, block, DIRECT_READ_BLOCK_SIZE_IN_BYTES);
+        STATS_ADD(&file_reader->stats, no_of_read_calls, 1);
+
+        if (bytes_read == -1)
+        {
+            // interrupted read is just repeated
+            if (errno == EINTR)
+            {
+                STATS_ADD(&file_reader->stats, no_of_read_retries, 1);
+                continue;
+            }
+
+            if (errno != EINVAL)
+            {
+                free(block);
+                return false;
+            }
+
+            break;
+        }
+
+        // no more content
+        if (bytes_read == 0)
+        {
+            free(block);
+            return true;
+        }
+
+        // file may grow meanwhile, bytes after size are not taken
+        const size_t bytes_left = size - *bytes_read_from_file;
+        const size_t bytes_copied = (size_t)bytes_read < bytes_left ? (size_t)bytes_read : bytes_left;
+
+        memcpy(buffer + *bytes_read_from_file, block, bytes_copied);
+        *bytes_read_from_file += bytes_copied;
+        STATS_ADD(&file_reader->stats, bytes_read, bytes_copied);
+    }
+
+    if (block == NULL || *bytes_read_from_file < size)
+    {
+        // offset of file still equals the number of bytes read, it is continued without O_DIRECT
+        const int file_status_flags = fcntl(fd, F_GETFL);
+        size_t bytes_read_through_cache = 0;
+
+        free(block);
+
+        if (file_status_flags == -1 || fcntl(fd, F_SETFL, file_status_flags & ~O_DIRECT) == -1
+            || read_from_file(file_reader, fd, buffer + *bytes_read_from_file, size - *bytes_read_from_file,
+                              &bytes_read_through_cache) == false)
+        {
+            return false;
+        }
+
+        *bytes_read_from_file += bytes_read_through_cache;
+
+        return true;
+    }
+
+    free(block);
+
+    return true;
+}
+
+/*
+    Size comes from fstat of the same descriptor, if the file changes meanwhile, it is read again.
+    Read mode decides what is left in page cache. Read-once and direct modes tell the kernel
+    to drop pages of the file after loading, so other data stays cached.
+*/
+static bool load_normal_file(File_Reader* const file_reader, const int fd, const struct stat* const file_stat_buffer)
+{
+    size_t read_attempts_counter = 0;
+    const File_Reader_Read_Mode read_mode = file_reader->options.read_mode;
+    struct stat current_file_stat = *file_stat_buffer;
+    bool is_loaded = false;
+
+    // O_DIRECT is set on the open descriptor, file system which refuses it is read through page cache
+    const int file_status_flags = fcntl(fd, F_GETFL);
+    const bool is_direct = read_mode == FILE_READER_READ_DIRECT && file_status_flags != -1
+                           && fcntl(fd, F_SETFL, file_status_flags | O_DIRECT) == 0;
+
+    if (read_mode == FILE_READER_READ_ONCE)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    while (true)
+    {
+        const size_t file_size_in_bytes = (size_t)current_file_stat.st_size;
+
+        // there is no reader for empty file, the file could be truncated meanwhile
+        if (file_size_in_bytes == 0)
+        {
+            break;
+        }
+
+        // buffer is extended by 1 becasue we need to add \0 at the end
+        const size_t buffer_size_in_bytes = file_size_in_bytes + 1;
+
+        if (reserve_buffer(file_reader, buffer_size_in_bytes) == false)
+        {
+            break;
+        }
+
+        // read the file directly to the buffer of reader
+        size_t bytes_read_from_file = 0;
+        const bool is_read = is_direct == true ?
+            read_direct_from_file(file_reader, fd, file_reader->buffer, file_size_in_bytes, &bytes_read_from_file) :
+            read_from_file(file_reader, fd, file_reader->buffer, file_size_in_bytes, &bytes_read_from_file);
+
+        /* if error occurs or bytes read from file are not equal the file size then
+           try again MAX_NO_OF_READ_ATTEMPTS times, if still error close function */
+        if (is_read == false || bytes_read_from_file != file_size_in_bytes)
+        {
+            ++read_attempts_counter;
+            if (read_attempts_counter >= MAX_NO_OF_READ_ATTEMPTS)
+            {
+                //printf("Can't perform operations on file \"%s\"\n", file_reader->name);
+                break;
+            }
+
+            // size could change, read the file once again from the beginning
+            if (fstat(fd, &current_file_stat) == -1 || lseek(fd, 0, SEEK_SET) == -1)
+            {
+                break;
+            }
+
+            remember_file_identity(file_reader, &current_file_stat);
+            STATS_ADD(&file_reader->stats, no_of_read_retries, 1);
+            continue;
+        }
+
+        // Add line termination at the end of buffer, -1 beacuse array starts with index 0
+        file_reader->buffer[buffer_size_in_bytes - 1] = '\0';
+        file_reader->buffer_size = buffer_size_in_bytes;
+        is_loaded = true;
+
+        break;
+    }
+
+    // pages read through cache (also when O_DIRECT wasn't supported) are not needed anymore
+    if (read_mode != FILE_READER_READ_CACHED)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+
+    return is_loaded;
+}
+
+/*
+    Size of virtual file is unknown, so read it until EOF to the buffer which is enlarged
+    (doubled) each time it gets full. Bytes which are already read are kept,
+    so the file is read only once and the content is never copied to another buffer.
+*/
+static bool load_virtual_file(File_Reader* const file_reader, const int fd)
+{
+    // +1 in each allocation for '\0' sign at the end of content
+    const size_t size_hint = file_reader->options.virtual_file_size_hint > 0 ?
+        file_reader->options.virtual_file_size_hint : DEFAULT_VIRTUAL_FILE_SIZE_HINT_IN_BYTES;
+
+    // hint without space for '\0' can't be allocated
+    if (size_hint == SIZE_MAX)
+    {
+        //printf("Incorrect size hint of file \"%s\"\n", file_reader->name);
+        return false;
+    }
+
+    if (reserve_buffer(file_reader, size_hint + 1) == false)
+    {
+        return false;
+    }
+
+    size_t bytes_read_from_file = 0;
+
+    while (true)
+    {
+        // leave space for '\0'
+        const size_t space_in_buffer = file_reader->buffer_capacity - 1 - bytes_read_from_file;
+
+        if (space_in_buffer == 0)
+        {
+            //printf("Buffer size (%ld bytes) was too small, double the size of buffer \n", file_reader->buffer_capacity);
+            if (reserve_buffer(file_reader, file_reader->buffer_capacity * 2) == false)
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        size_t bytes_read = 0;
+        if (read_from_file(file_reader, fd, file_reader->buffer + bytes_read_from_file, space_in_buffer, &bytes_read) == false)
+        {
+            //printf("Can't perform operations on file \"%s\"\n", file_reader->name);
+            return false;
+        }
+
+        bytes_read_from_file += bytes_read;
+
+        // buffer is not full, so end of file has been reached
+        if (bytes_read < space_in_buffer)
+        {
+            break;
+        }
+    }
+
+    // the same as for normal file, there is no reader for empty file
+    if (bytes_read_from_file == 0)
+    {
+        return false;
+    }
+
+    // add space for '\0' sign
+    file_reader->buffer_size = bytes_read_from_file + 1;
+    file_reader->buffer[file_reader->buffer_size - 1] = '\0';
+
+    return true;
+}
+
+/*
+    Decompress the file straight to the buffer. When the format stores size of content,
+    buffer is allocated once for the whole content, otherwise it grows as for virtual files.
+    Stored size is only a hint, damaged or crafted file can't make the buffer bigger
+    than MAX_COMPRESSION_RATIO times the compressed file before its content is decompressed.
+*/
+static bool load_compressed_file(File_Reader* const file_reader, const int fd, const struct stat* const file_stat_buffer)
+{
+    Decompressor* const decompressor = decompressor_open(fd, file_reader->compression_format);
+    if (decompressor == NULL)
+    {
+        //printf("Can't open a compressed file: \"%s\"\n", file_reader->name);
+        return false;
+    }
+
+    size_t size_hint = 0;
+    if (decompressor_get_content_size(decompressor, &size_hint) == false || size_hint == 0 || size_hint == SIZE_MAX)
+    {
+        size_hint = file_reader->options.virtual_file_size_hint > 0 ?
+            file_reader->options.virtual_file_size_hint : DEFAULT_VIRTUAL_FILE_SIZE_HINT_IN_BYTES;
+    }
+
+    const size_t compressed_size = (size_t)file_stat_buffer->st_size;
+    if (compressed_size < SIZE_MAX / MAX_COMPRESSION_RATIO && size_hint > compressed_size * MAX_COMPRESSION_RATIO)
+    {
+        size_hint = compressed_size * MAX_COMPRESSION_RATIO;
+    }
+
+    // +1 for '\0' sign at the end of content
+    if (reserve_buffer(file_reader, size_hint + 1) == false)
+    {
+        decompressor_close(decompressor);
+        return false;
+    }
+
+    size_t bytes_decompressed = 0;
+
+    while (true)
+    {
+        // leave space for '\0'
+        const size_t space_in_buffer = file_reader->buffer_capacity - 1 - bytes_decompressed;
+
+        if (space_in_buffer == 0)
+        {
+            // size hint can be too small (e.g. gzip with many members), check before enlarging the buffer
+            char next_byte = 0;
+            size_t bytes_read = 0;
+
+            if (decompressor_read(decompressor, &next_byte, 1, &bytes_read) == false)
+            {
+                decompressor_close(decompressor);
+                return false;
+            }
+
+            if (bytes_read == 0)
+            {
+                break;
+            }
+
+            if (reserve_buffer(file_reader, file_reader->buffer_capacity * 2) == false)
+            {
+                decompressor_close(decompressor);
+                return false;
+            }
+
+            file_reader->buffer[bytes_decompressed++] = next_byte;
+            STATS_ADD(&file_reader->stats, bytes_read, 1);
+            continue;
+        }
+
+        size_t bytes_read = 0;
+        if (decompressor_read(decompressor, file_reader->buffer + bytes_decompressed, space_in_buffer, &bytes_read) == false)
+        {
+            //printf("Can't decompress file \"%s\"\n", file_reader->name);
+            decompressor_close(decompressor);
+            return false;
+        }
+
+        bytes_decompressed += bytes_read;
+        STATS_ADD(&file_reader->stats, bytes_read, bytes_read);
+
+        // buffer is not full, so end of content has been reached
+        if (bytes_read < space_in_buffer)
+        {
+            break;
+        }
+    }
+
+    decompressor_close(decompressor);
+
+    // the same as for normal file, there is no reader for empty content
+    if (bytes_decompressed == 0)
+    {
+        return false;
+    }
+
+    // add space for '\0' sign
+    file_reader->buffer_size = bytes_decompressed + 1;
+    file_reader->buffer[file_reader->buffer_size - 1] = '\0';
+
+    return true;
+}
+
+/*
+    Only the last lines of file are read, in blocks from the end of file backwards until the block
+    with the beginning of the first of them. Blocks are placed one before another at the end of buffer,
+    so each byte is read once, at last the lines are moved to the beginning of buffer.
+    '\n' at the end of file is a part of the last line, the same as when the whole file is read.
+*/
+static bool load_tail_of_file(File_Reader* const file_reader, const int fd, const struct stat* const file_stat_buffer)
+{
+    const size_t file_size_in_bytes = (size_t)file_stat_buffer->st_size;
+    size_t no_of_new_lines = file_reader->options.tail_no_of_lines;
+    size_t content_size = 0;     // bytes read so far, they end right before the last byte of buffer
+    size_t content_begin = 0;    // offset in buffer of the first byte of the first line found so far
+    bool is_first_line_found = false;
+
+    while (content_size < file_size_in_bytes && is_first_line_found == false)
+    {
+        const size_t bytes_before_content = file_size_in_bytes - content_size;
+        const size_t block_size = bytes_before_content < TAIL_READ_BLOCK_SIZE_IN_BYTES ?
+            bytes_before_content : TAIL_READ_BLOCK_SIZE_IN_BYTES;
+
+        // content stays at the end of buffer, so it is moved to the end of enlarged buffer
+        if (content_size + block_size + 1 > file_reader->buffer_capacity)
+        {
+            const size_t previous_capacity = file_reader->buffer_capacity;
+            const size_t doubled_capacity = previous_capacity * 2;
+            const size_t needed_capacity = content_size + block_size + 1;
+
+            if (reserve_buffer(file_reader, needed_capacity > doubled_capacity ? needed_capacity : doubled_capacity) == false)
+            {
+                return false;
+            }
+
+            if (content_size > 0)
+            {
+                memmove(file_reader->buffer + file_reader->buffer_capacity - 1 - content_size,
+                        file_reader->buffer + previous_capacity - 1 - content_size, content_size);
+            }
+        }
+
+        const size_t block_begin = file_reader->buffer_capacity - 1 - content_size - block_size;
+        size_t bytes_read_from_file = 0;
+
+        // file truncated meanwhile can't be read, it is loaded again by the next refresh
+        if (lseek(fd, (off_t)(bytes_before_content - block_size), SEEK_SET) == -1
+            || read_from_file(file_reader, fd, file_reader->buffer + block_begin, block_size, &bytes_read_from_file) == false
+            || bytes_read_from_file != block_size)
+        {
+            //printf("Can't perform operations on file \"%s\"\n", file_reader->name);
+            return false;
+        }
+
+        // '\n' at the end of file doesn't start another line
+        const bool is_file_end = content_size == 0;
+        const size_t scan_end = block_begin + block_size
+                                - (is_file_end == true && file_reader->buffer[block_begin + block_size - 1] == '\n' ? 1 : 0);
+        size_t new_line_position = 0;
+
+        is_first_line_found = line_index_find_last_new_line(file_reader->buffer, block_begin, scan_end,
+                                                            LINE_INDEX_SCANNER_AUTO, &no_of_new_lines,
+                                                            &new_line_position);
+        content_begin = is_first_line_found == true ? new_line_position + 1 : block_begin;
+        content_size += block_size;
+    }
+
+    const size_t tail_size = file_reader->buffer_capacity - 1 - content_begin;
+
+    memmove(file_reader->buffer, file_reader->buffer + content_begin, tail_size);
+    file_reader->buffer_size = tail_size + 1;
+    file_reader->buffer[tail_size] = '\0';
+
+    return true;
+}
+
+/*
+    Drop lines of loaded content before the last tail_no_of_lines lines
+*/
+static void keep_last_lines(File_Reader* const file_reader)
+{
+    const size_t file_size = file_reader->buffer_size - 1;
+    if (file_size == 0)
+    {
+        return;
+    }
+
+    const size_t scan_end = file_size - (file_reader->buffer[file_size - 1] == '\n' ? 1 : 0);
+    size_t no_of_new_lines = file_reader->options.tail_no_of_lines;
+    size_t new_line_position = 0;
+
+    if (line_index_find_last_new_line(file_reader->buffer, 0, scan_end, LINE_INDEX_SCANNER_AUTO,
+                                      &no_of_new_lines, &new_line_position) == false)
+    {
+        return;
+    }
+
+    const size_t tail_size = file_size - new_line_position - 1;
+
+    memmove(file_reader->buffer, file_reader->buffer + new_line_position + 1, tail_size);
+    file_reader->buffer_size = tail_size + 1;
+    file_reader->buffer[tail_size] = '\0';
+}
+
+/*
+    Map the file read-only instead of copying it to the buffer.
+    Mapping is placed at the beginning of an anonymous reservation which is
+    at least one byte longer than the file. Bytes past the end of file are zero,
+    both in the last page of the file and in the reserved pages,
+    so the buffer is always terminated by '\0' without touching the file.
+*/
+static bool load_mapped_file(File_Reader* const file_reader, const int fd, const struct stat* const file_stat_buffer)
+{
+    // previous mapping is released, the file could change its size
+    if (file_reader->mapping_size > 0)
+    {
+        munmap(file_reader->buffer, file_reader->mapping_size);
+        file_reader->mapping_size = 0;
+        file_reader->buffer = NULL;
+    }
+
+    const size_t file_size_in_bytes = (size_t)file_stat_buffer->st_size;
+
+    if (file_size_in_bytes == 0)
+    {
+        // the same as for normal file, there is no reader for empty file
+        return false;
+    }
+
+    const long page_size = sysconf(_SC_PAGESIZE);
+    const size_t page_size_in_bytes = page_size > 0 ? (size_t)page_size : 4096;
+
+    // buffer is extended by 1 because we need '\0' at the end, round it up to whole pages
+    const size_t buffer_size_in_bytes = file_size_in_bytes + 1;
+    const size_t mapping_size =
+        (buffer_size_in_bytes + page_size_in_bytes - 1) / page_size_in_bytes * page_size_in_bytes;
+
+    void* const reservation =
+        mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reservation == MAP_FAILED)
+    {
+        //printf("Can't reserve memory for mapping of file: \"%s\"\n", file_reader->name);
+        return false;
+    }
+
+    void* const mapping =
+        mmap(reservation, file_size_in_bytes, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        //printf("Can't map file: \"%s\"\n", file_reader->name);
+        munmap(reservation, mapping_size);
+        return false;
+    }
+
+    file_reader->buffer_size = buffer_size_in_bytes;
+    file_reader->mapping_size = mapping_size;
+    file_reader->buffer = mapping;
+
+    return true;
+}
+
+/*
+    Make line_offset[line] known, SIZE_MAX means the whole index. Lazy and eager modes
+    build the whole index at once, incremental mode scans the buffer only as far as needed.
+    Index extended by follow is continued from the last line in all modes.
+    With line_index_file option the index is taken from the line index file when it matches
+    the file and complete index is saved there otherwise.
+    Has to be called with line_index_mutex locked, unless the reader is not shared yet.
+*/
+static bool file_reader_index_lines(File_Reader* const file_reader, const size_t line)
+{
+    if (__atomic_load_n(&file_reader->is_line_index_built, __ATOMIC_RELAXED) == true)
+    {
+        return true;
+    }
+
+    STATS_PHASE_BEGIN(index_begin);
+    const bool is_indexed = file_reader_update_line_index(file_reader, line);
+    STATS_PHASE_END(&file_reader->stats, FILE_READER_PHASE_INDEX, file_reader->name, index_begin, is_indexed);
+
+    return is_indexed;
+}
+
+/*
+    Work of file_reader_index_lines, the index is not built yet
+*/
+static bool file_reader_update_line_index(File_Reader* const file_reader, const size_t line)
+{
+    bool is_built = false;
+
+    // nothing is scanned yet, so the whole index may come from the line index file
+    if (file_reader->no_of_line_offsets == 0 && file_reader_map_line_index_file(file_reader) == true)
+    {
+        __atomic_store_n(&file_reader->is_line_index_built, true, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    if (file_reader->options.index_build == FILE_READER_INDEX_BUILD_INCREMENTAL || file_reader->no_of_line_offsets > 0)
+    {
+        bool is_complete = false;
+
+        if (line_index_build_until(file_reader->buffer,
+                                   file_reader->buffer_size,
+                                   LINE_INDEX_SCANNER_AUTO,
+                                   &file_reader->options.allocator,
+                                   line,
+                                   &file_reader->line_offset,
+                                   &file_reader->line_offset_capacity,
+                                   &file_reader->no_of_line_offsets,
+                                   &file_reader->scanned_size,
+                                   &file_reader->no_of_lines,
+                                   &is_complete) == false)
+        {
+            return false;
+        }
+
+        // offsets found so far are enough for the caller
+        if (is_complete == false)
+        {
+            return true;
+        }
+
+        is_built = true;
+    }
+    else
+    {
+        is_built = file_reader_build_line_index(file_reader);
+    }
+
+    if (is_built == true)
+    {
+        // saved index is always a wide one, the same as built one before compaction
+        file_reader_save_line_index_file(file_reader);
+        is_built = file_reader_compact_line_index(file_reader);
+    }
+
+    if (is_built == true)
+    {
+        // callers which see the flag see also the complete index
+        __atomic_store_n(&file_reader->is_line_index_built, true, __ATOMIC_RELEASE);
+    }
+
+    return is_built;
+}
+
+/*
+    Build the whole line index if it is not built yet. Once built, index is only read,
+    so the mutex is taken only by callers which come before that.
+*/
+static bool file_reader_ensure_line_index(File_Reader* const file_reader)
+{
+    if (__atomic_load_n(&file_reader->is_line_index_built, __ATOMIC_ACQUIRE) == true)
+    {
+        return true;
+    }
+
+    pthread_mutex_lock(&file_reader->line_index_mutex);
+    const bool is_built = file_reader_index_lines(file_reader, SIZE_MAX);
+    pthread_mutex_unlock(&file_reader->line_index_mutex);
+
+    return is_built;
+}
+
+/*
+    Find the line, building line index as far as needed. Incremental index may be
+    reallocated by another caller until it is complete, so it is read under the mutex.
+*/
+static bool file_reader_find_line(File_Reader* const file_reader, const size_t line,
+                                  File_Reader_Line_View* const line_view)
+{
+    if (__atomic_load_n(&file_reader->is_line_index_built, __ATOMIC_ACQUIRE) == true)
+    {
+        return locate_line(file_reader, line, line_view);
+    }
+
+    pthread_mutex_lock(&file_reader->line_index_mutex);
+    const bool is_found = file_reader_index_lines(file_reader, line)
+                          && locate_line(file_reader, line, line_view);
+    pthread_mutex_unlock(&file_reader->line_index_mutex);
+
+    return is_found;
+}
+
+/*
+    Fill the view of line if the line is covered by line index built so far
+*/
+static bool locate_line(const File_Reader* const file_reader, const size_t line,
+                        File_Reader_Line_View* const line_view)
+{
+    const bool is_line_index_built = __atomic_load_n(&file_reader->is_line_index_built, __ATOMIC_RELAXED);
+
+    // incomplete index covers lines which have the next offset found already
+    const size_t no_of_known_lines = is_line_index_built == true ? file_reader->no_of_lines
+        : (file_reader->no_of_line_offsets > 0 ? file_reader->no_of_line_offsets - 1 : 0);
+
+    if (line > no_of_known_lines || line < 1)
+    {
+        //printf("Incorrect line number to get\n");
+        return false;
+    }
+
+    line_view->data = &file_reader->buffer[line_offset_at(file_reader, line - 1)];
+    line_view->len = calculate_line_length(file_reader, line);
+
+    return true;
+}
+
+/*
+    Count lines and calculate their offsets in a single scan of the buffer,
+    buffers above the threshold are scanned by several threads.
+*/
+static bool file_reader_build_line_index(File_Reader* const file_reader)
+{
+    if (file_reader == NULL)
+    {
+        //printf("Can't open file_reader\n");
+        return false;
+    }
+
+    const File_Reader_Options* const options = &file_reader->options;
+    bool is_built = false;
+
+    if (options->no_of_threads != 1 && file_reader->buffer_size > options->parallel_threshold)
+    {
+        is_built = line_index_build_parallel(file_reader->buffer,
+                                             file_reader->buffer_size,
+                                             LINE_INDEX_SCANNER_AUTO,
+                                             options->no_of_threads,
+                                             &options->allocator,
+                                             &file_reader->line_offset,
+                                             &file_reader->line_offset_capacity,
+                                             &file_reader->no_of_lines);
+    }
+    else
+    {
+        is_built = line_index_build(file_reader->buffer,
+                                    file_reader->buffer_size,
+                                    LINE_INDEX_SCANNER_AUTO,
+                                    &options->allocator,
+                                    &file_reader->line_offset,
+                                    &file_reader->line_offset_capacity,
+                                    &file_reader->no_of_lines);
+    }
+
+    return is_built;
+}
+
+/*
+    In compact modes offsets of complete index are converted to 32-bit ones
+*/
+static bool file_reader_compact_line_index(File_Reader* const file_reader)
+{
+    const File_Reader_Options* const options = &file_reader->options;
+
+    if (options->index_mode == FILE_READER_INDEX_WIDE)
+    {
+        return true;
+    }
+
+    return line_index_compact(&options->allocator,
+                              file_reader->no_of_lines,
+                              options->index_mode == FILE_READER_INDEX_COMPACT,
+                              &file_reader->line_offset,
+                              &file_reader->line_offset_capacity,
+                              &file_reader->line_base,
+                              &file_reader->line_base_capacity,
+                              &file_reader->line_index_format);
+}
+
+/*
+    Use offsets of line index file if it was saved for the file as it is now,
+    only regular files can have such index
+*/
+static bool file_reader_map_line_index_file(File_Reader* const file_reader)
+{
+    if (file_reader->options.line_index_file == false || file_reader->kind == FILE_KIND_VIRTUAL
+        || file_reader->kind == FILE_KIND_COMPRESSED || file_reader->kind == FILE_KIND_TAIL)
+    {
+        return false;
+    }
+
+    char* const index_file_name = get_path_name(file_reader, LINE_INDEX_FILE_SUFFIX);
+    if (index_file_name == NULL)
+    {
+        return false;
+    }
+
+    const Line_Index_Source source = {file_reader->buffer_size - 1,
+                                      file_reader->file_mtime.tv_sec,
+                                      file_reader->file_mtime.tv_nsec,
+                                      (uint32_t)file_reader->file_mode,
+                                      file_reader->buffer};
+    size_t* line_offset = NULL;
+    size_t no_of_lines = 0;
+    size_t mapping_size = 0;
+
+    const bool is_mapped = line_index_file_map(index_file_name, &source, &line_offset, &no_of_lines, &mapping_size);
+    free(index_file_name);
+
+    if (is_mapped == false)
+    {
+        return false;
+    }
+
+    // allocated array is not needed anymore, mapped one is used instead
+    if (file_reader->line_offset != NULL)
+    {
+        allocator_deallocate(&file_reader->options.allocator, file_reader->line_offset);
+    }
+
+    file_reader->line_offset = line_offset;
+    file_reader->line_offset_capacity = 0;
+    file_reader->line_index_mapping_size = mapping_size;
+    file_reader->no_of_lines = no_of_lines;
+
+    return true;
+}
+
+/*
+    Save complete wide index for the next readers of the file, failure just means
+    that they have to scan the file, so it is not reported
+*/
+static void file_reader_save_line_index_file(const File_Reader* const file_reader)
+{
+    if (file_reader->options.line_index_file == false || file_reader->kind == FILE_KIND_VIRTUAL
+        || file_reader->kind == FILE_KIND_COMPRESSED || file_reader->kind == FILE_KIND_TAIL
+        || file_reader->line_index_format != LINE_INDEX_FORMAT_WIDE || file_reader->line_offset == NULL)
+    {
+        return;
+    }
+
+    char* const index_file_name = get_path_name(file_reader, LINE_INDEX_FILE_SUFFIX);
+    if (index_file_name == NULL)
+    {
+        return;
+    }
+
+    const Line_Index_Source source = {file_reader->buffer_size - 1,
+                                      file_reader->file_mtime.tv_sec,
+                                      file_reader->file_mtime.tv_nsec,
+                                      (uint32_t)file_reader->file_mode,
+                                      file_reader->buffer};
+
+    if (line_index_file_save(index_file_name, &source, file_reader->line_offset, file_reader->no_of_lines) == false)
+    {
+        //printf("Can't save line index file: \"%s\"\n", index_file_name);
+    }
+
+    free(index_file_name);
+}
+
+/*
+    Path of the file with suffix for functions which have no variant relative to directory descriptor.
+    File name relative to dir_fd is reached through the descriptor in /proc.
+*/
+static char* get_path_name(const File_Reader* const file_reader, const char* const suffix)
+{
+    char directory_name[32] = "";
+
+    if (file_reader->dir_fd != AT_FDCWD && file_reader->name[0] != '/')
+    {
+        snprintf(directory_name, sizeof(directory_name), "/proc/self/fd/%d/", file_reader->dir_fd);
+    }
+
+    const size_t directory_name_length = strlen(directory_name);
+    const size_t name_length = strlen(file_reader->name);
+    const size_t suffix_size = strlen(suffix) + 1;
+    char* const path_name = malloc(directory_name_length + name_length + suffix_size);
+
+    if (path_name != NULL)
+    {
+        memcpy(path_name, directory_name, directory_name_length);
+        memcpy(path_name + directory_name_length, file_reader->name, name_length);
+        memcpy(path_name + directory_name_length + name_length, suffix, suffix_size);
+    }
+
+    return path_name;
+}
+
+static inline size_t line_offset_at(const File_Reader* const file_reader, const size_t index)
+{
+    return line_index_get_offset(file_reader->line_offset,
+                                 file_reader->line_base,
+                                 file_reader->line_index_format,
+                                 index);
+}
+
+/*
+    Line has to be covered by line index, line_offset[line] is the beginning of the next line
+    or the end marker. Only the last line ends at the end marker, '\n' at the end of file is a part of it.
+*/
+static size_t calculate_line_length(const File_Reader* const file_reader, const size_t line)
+{
+    if (file_reader == NULL)
+    {
+        return 0;
+    }
+
+    const size_t file_size = file_reader->buffer_size - 1;
+    const size_t line_begin = line_offset_at(file_reader, line - 1);
+    const size_t next_line_begin = line_offset_at(file_reader, line);
+
+    size_t line_length = 0;
+
+    /*
+        Example of line_lenght calculation:
+            line 1: ab     offset[1] = 3
+            line 2: cd     offset[2] = 6
+            line 3: efg    offset[3] = 10
+            line 4: h      offset[4] = 12
+            line 5: ij     offset[5] = buffer_size = file_size + 1 = 14 + 1 = 15
+
+            line_length(3) = 10(offset[3]) - 6(offset[2]) - 1(character \n) = 3
+            line_length(5) = 14(file_size) - 12(offset[4]) = 2
+    */
+    if (next_line_begin < file_size)
+    {
+        line_length = next_line_begin - line_begin - 1;
+    }
+    else
+    {
+        line_length = file_size - line_begin;
+    }
+
+    return line_length;
+}
+
+#ifdef FILE_READER_WITH_STATS
+/*
+    Allocator of reader with stats counts allocations and passes them to the allocator from options
+*/
+static void* stats_allocate(void* const file_reader, const size_t size)
+{
+    File_Reader* const counted_reader = file_reader;
+    STATS_ADD(&counted_reader->stats, no_of_allocations, 1);
+
+    return allocator_allocate(&counted_reader->user_allocator, size);
+}
+
+static void* stats_reallocate(void* const file_reader, void* const memory, const size_t old_size, const size_t new_size)
+{
+    File_Reader* const counted_reader = file_reader;
+    STATS_ADD(&counted_reader->stats, no_of_allocations, 1);
+
+    return allocator_reallocate(&counted_reader->user_allocator, memory, old_size, new_size);
+}
+
+static void stats_deallocate(void* const file_reader, void* const memory)
+{
+    // reader itself can be the released memory, so its allocator is copied before
+    const File_Reader_Allocator user_allocator = ((File_Reader*)file_reader)->user_allocator;
+
+    allocator_deallocate(&user_allocator, memory);
+}
+#endif
+
+char* file_reader_get_copy_of_line(const File_Reader* const file_reader, const size_t line)
+{
+    if (file_reader == NULL)
+    {
+        //printf("Can't open given file_reader\n");
+        return NULL;
+    }
+
+    if (file_reader->buffer_size == 0)
+    {
+        //printf("Size of file_reader buffer content is 0\n");
+        return NULL;
+    }
+
+    File_Reader_Line_View line_view = {NULL, 0};
+
+    // line index is built on demand, it doesn't change anything what the caller can see
+    if (file_reader_find_line((File_Reader*)file_reader, line, &line_view) == false)
+    {
+        return NULL;
+    }
+
+    const size_t line_length = line_view.len;
+
+    if (line_length == 0)
+    {
+        return NULL;
+    }
+
+    // create buffer for specified line, add +1 for '\0' sign
+    char* line_buffer = allocator_allocate(&file_reader->options.allocator, line_length + 1);
+    if (line_buffer == NULL)
+    {
+        return NULL;
+    }
+
+    // copy content of line to new buffer
+    memcpy(line_buffer, line_view.data, line_length);
+    
+    // add null termination at the end of string
+    line_buffer[line_length] = '\0';
 
     return line_buffer;
 }
@@ -539,4 +1885,234 @@ void file_reader_delete_copy_of_line(char* const line_buffer)
     free(line_buffer);
 }
 
+/*
+    Copies are released by the allocator of the reader which made them, the reader has to exist
+*/
+void file_reader_release_copy_of_file_buffer(const File_Reader* const file_reader, char* const copy_buffer)
+{
+    if (file_reader == NULL || copy_buffer == NULL)
+    {
+        return;
+    }
+
+    allocator_deallocate(&file_reader->options.allocator, copy_buffer);
+}
+
+void file_reader_release_copy_of_line(const File_Reader* const file_reader, char* const line_buffer)
+{
+    if (file_reader == NULL || line_buffer == NULL)
+    {
+        return;
+    }
+
+    allocator_deallocate(&file_reader->options.allocator, line_buffer);
+}
+
+File_Reader_Line_View file_reader_get_line_view(const File_Reader* const file_reader, const size_t line)
+{
+    File_Reader_Line_View line_view = {NULL, 0};
+
+    if (file_reader == NULL || file_reader->buffer_size == 0)
+    {
+        //printf("Can't open given file_reader\n");
+        return line_view;
+    }
+
+    // unlike the copy of line, empty line gives a valid view with length 0
+    if (file_reader_find_line((File_Reader*)file_reader, line, &line_view) == false)
+    {
+        return (File_Reader_Line_View){NULL, 0};
+    }
+
+    return line_view;
+}
+
+size_t file_reader_get_line_views(const File_Reader* const file_reader,
+                                  const size_t first_line,
+                                  const size_t no_of_lines,
+                                  File_Reader_Line_View* const line_views)
+{
+    if (file_reader == NULL || line_views == NULL || file_reader->buffer_size == 0)
+    {
+        //printf("Can't open given file_reader\n");
+        return 0;
+    }
+
+    size_t lines_got = 0;
+
+    // stop at the last line, line index is built on demand
+    while (lines_got < no_of_lines
+           && file_reader_find_line((File_Reader*)file_reader, first_line + lines_got, &line_views[lines_got]) == true)
+    {
+        ++lines_got;
+    }
+
+    return lines_got;
+}
+
+size_t file_reader_get_line_index_size(const File_Reader* const file_reader)
+{
+    if (file_reader == NULL)
+    {
+        //printf("Can't open given file_reader\n");
+        return 0;
+    }
+
+    return file_reader->line_offset_capacity * sizeof(*file_reader->line_offset)
+           + file_reader->line_base_capacity * sizeof(*file_reader->line_base);
+}
+
+/*
+    Binary search over beginnings of lines. Returns number of line which contains the byte
+    at offset of file buffer or 0 if the offset is not inside of the file.
+*/
+size_t file_reader_line_of_offset(const File_Reader* const file_reader, const size_t offset)
+{
+    if (file_reader == NULL)
+    {
+        //printf("Can't open given file_reader\n");
+        return 0;
+    }
+
+    if (offset >= file_reader_get_file_size(file_reader))
+    {
+        return 0;
+    }
+
+    // line index is built on demand, it doesn't change anything what the caller can see
+    File_Reader* const indexed_reader = (File_Reader*)file_reader;
+
+    if (file_reader_ensure_line_index(indexed_reader) == false)
+    {
+        return 0;
+    }
+
+    // the first line starts at offset 0, so the result is always between them
+    size_t first_line = 1;
+    size_t last_line = indexed_reader->no_of_lines;
+
+    while (first_line < last_line)
+    {
+        const size_t middle_line = first_line + (last_line - first_line + 1) / 2;
+
+        if (line_offset_at(indexed_reader, middle_line - 1) <= offset)
+        {
+            first_line = middle_line;
+        }
+        else
+        {
+            last_line = middle_line - 1;
+        }
+    }
+
+    return first_line;
+}
+
+/*
+    One view of lines from first_line to last_line, '\n' between them included.
+    Range is cut at the last line of file.
+*/
+File_Reader_Line_View file_reader_get_line_range(const File_Reader* const file_reader,
+                                                 const size_t first_line,
+                                                 const size_t last_line)
+{
+    File_Reader_Line_View line_range = {NULL, 0};
+
+    if (file_reader == NULL || file_reader->buffer_size == 0)
+    {
+        //printf("Can't open given file_reader\n");
+        return line_range;
+    }
+
+    if (first_line > last_line)
+    {
+        //printf("Incorrect range of lines to get\n");
+        return line_range;
+    }
+
+    // line index is built on demand, it doesn't change anything what the caller can see
+    File_Reader* const indexed_reader = (File_Reader*)file_reader;
+    File_Reader_Line_View first_line_view = {NULL, 0};
+    File_Reader_Line_View last_line_view = {NULL, 0};
+
+    if (file_reader_find_line(indexed_reader, first_line, &first_line_view) == false)
+    {
+        return line_range;
+    }
+
+    if (file_reader_find_line(indexed_reader, last_line, &last_line_view) == false)
+    {
+        // last_line is past the end of file, whole index is needed to know which line is the last one
+        if (file_reader_ensure_line_index(indexed_reader) == false
+            || file_reader_find_line(indexed_reader, indexed_reader->no_of_lines, &last_line_view) == false)
+        {
+            return line_range;
+        }
+    }
+
+    line_range.data = first_line_view.data;
+    line_range.len = (size_t)(last_line_view.data + last_line_view.len - first_line_view.data);
+
+    return line_range;
+}
+
+/*
+    Counters of the reader since it was created, refresh and follow add to them
+*/
+bool file_reader_get_stats(const File_Reader* const file_reader, File_Reader_Stats* const stats)
+{
+    if (file_reader == NULL || stats == NULL)
+    {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+#ifdef FILE_READER_WITH_STATS
+    stats_copy(stats, &file_reader->stats);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+    Value of the first line with key, found without scanning the file. View is empty
+    ({NULL, 0}) when there is no such key or the reader has no key/value index.
+*/
+File_Reader_Line_View file_reader_kv_get(const File_Reader* const file_reader, const char* const key)
+{
+    File_Reader_Line_View value = {NULL, 0};
+
+    if (file_reader == NULL || key == NULL || file_reader->buffer_size == 0)
+    {
+        return value;
+    }
+
+    if (kv_index_find(&file_reader->kv_index, file_reader->buffer, key, strlen(key), &value) == false)
+    {
+        return (File_Reader_Line_View){NULL, 0};
+    }
+
+    return value;
+}
+
+/*
+    Number at the beginning of value, unit after it is skipped (e.g. "MemAvailable:  8040304 kB")
+*/
+bool file_reader_kv_get_uint(const File_Reader* const file_reader, const char* const key, uint64_t* const value)
+{
+    File_Reader_Line_View number;
+
+    return file_reader_split_line(file_reader_kv_get(file_reader, key), NULL, &number, 1) == 1
+           && file_reader_parse_uint(number, value) == true;
+}
+
+bool file_reader_kv_get_int(const File_Reader* const file_reader, const char* const key, int64_t* const value)
+{
+    File_Reader_Line_View number;
 
+    return file_reader_split_line(file_reader_kv_get(file_reader, key), NULL, &number, 1) == 1
+           && file_reader_parse_int(number, value) == true;
+}
@@ -0,0 +1,271 @@
+#include "file_reader_allocator.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE_IN_BYTES (1024 * 1024)
+#define ARENA_ALIGNMENT 16
+
+typedef struct Arena_Block Arena_Block;
+
+struct Arena_Block
+{
+    Arena_Block* previous;  // blocks are released from the newest one
+    size_t       size;      // number of bytes in data
+    size_t       used;      // number of bytes of data already given away
+    unsigned char data[];
+};
+
+/*
+    Arena gives memory from big blocks by bumping a pointer, freeing of single allocation does nothing,
+    all of them are released at once by reset. The first block is kept by reset for reuse.
+*/
+struct File_Reader_Arena
+{
+    Arena_Block* first_block;
+    Arena_Block* current_block;
+    void*        last_allocation;  // the only allocation which can grow in place
+    size_t       block_size;
+};
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static Arena_Block* arena_block_new(size_t size, Arena_Block* previous);
+static size_t arena_block_aligned_offset(const Arena_Block* block);
+static void* arena_allocate(void* arena, size_t size);
+static void* arena_reallocate(void* arena, void* memory, size_t old_size, size_t new_size);
+static void arena_deallocate(void* arena, void* memory);
+
+
+/***********************************************************
+ * FILE_READER_ALLOCATOR_H FUNCTIONS DEFINITIONS
+***********************************************************/
+
+void* allocator_allocate(const File_Reader_Allocator* const allocator, const size_t size)
+{
+    if (allocator == NULL || allocator->allocate == NULL)
+    {
+        return malloc(size);
+    }
+
+    return allocator->allocate(allocator->context, size);
+}
+
+void* allocator_allocate_zeroed(const File_Reader_Allocator* const allocator, const size_t size)
+{
+    if (allocator == NULL || allocator->allocate == NULL)
+    {
+        return calloc(1, size);
+    }
+
+    void* const memory = allocator->allocate(allocator->context, size);
+    if (memory != NULL)
+    {
+        memset(memory, 0, size);
+    }
+
+    return memory;
+}
+
+void* allocator_reallocate(const File_Reader_Allocator* const allocator, void* const memory,
+                           const size_t old_size, const size_t new_size)
+{
+    if (allocator == NULL || allocator->reallocate == NULL)
+    {
+        return realloc(memory, new_size);
+    }
+
+    return allocator->reallocate(allocator->context, memory, old_size, new_size);
+}
+
+void allocator_deallocate(const File_Reader_Allocator* const allocator, void* const memory)
+{
+    if (allocator == NULL || allocator->deallocate == NULL)
+    {
+        free(memory);
+        return;
+    }
+
+    allocator->deallocate(allocator->context, memory);
+}
+
+bool allocator_is_valid(const File_Reader_Allocator* const allocator)
+{
+    const bool has_allocate = allocator->allocate != NULL;
+
+    return (allocator->reallocate != NULL) == has_allocate && (allocator->deallocate != NULL) == has_allocate;
+}
+
+/***********************************************************
+ * FILE_READER_H ARENA API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+File_Reader_Arena* file_reader_arena_new(size_t block_size)
+{
+    if (block_size == 0)
+    {
+        block_size = ARENA_DEFAULT_BLOCK_SIZE_IN_BYTES;
+    }
+
+    File_Reader_Arena* const arena = calloc(1, sizeof(*arena));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+
+    arena->block_size = block_size;
+    arena->first_block = arena_block_new(block_size, NULL);
+    if (arena->first_block == NULL)
+    {
+        free(arena);
+        return NULL;
+    }
+
+    arena->current_block = arena->first_block;
+
+    return arena;
+}
+
+File_Reader_Allocator file_reader_arena_get_allocator(File_Reader_Arena* const arena)
+{
+    File_Reader_Allocator allocator = {NULL, NULL, NULL, NULL};
+
+    if (arena != NULL)
+    {
+        allocator.allocate = arena_allocate;
+        allocator.reallocate = arena_reallocate;
+        allocator.deallocate = arena_deallocate;
+        allocator.context = arena;
+    }
+
+    return allocator;
+}
+
+void file_reader_arena_reset(File_Reader_Arena* const arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    Arena_Block* block = arena->current_block;
+    while (block != arena->first_block)
+    {
+        Arena_Block* const previous = block->previous;
+        free(block);
+        block = previous;
+    }
+
+    arena->first_block->used = 0;
+    arena->current_block = arena->first_block;
+    arena->last_allocation = NULL;
+}
+
+void file_reader_arena_delete(File_Reader_Arena* const arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    file_reader_arena_reset(arena);
+    free(arena->first_block);
+    free(arena);
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+static Arena_Block* arena_block_new(const size_t size, Arena_Block* const previous)
+{
+    Arena_Block* const block = malloc(sizeof(*block) + size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    block->previous = previous;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+/*
+    Offset of the first free byte of block which gives an aligned address
+*/
+static size_t arena_block_aligned_offset(const Arena_Block* const block)
+{
+    const uintptr_t first_free_address = (uintptr_t)(block->data + block->used);
+    const size_t padding = (ARENA_ALIGNMENT - first_free_address % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+
+    return block->used + padding;
+}
+
+static void* arena_allocate(void* const arena, const size_t size)
+{
+    File_Reader_Arena* const memory_arena = arena;
+    Arena_Block* block = memory_arena->current_block;
+    size_t offset = arena_block_aligned_offset(block);
+
+    if (offset > block->size || size > block->size - offset)
+    {
+        // allocation bigger than block gets a block of its own size, with space for alignment
+        const size_t new_block_size = size + ARENA_ALIGNMENT > memory_arena->block_size ?
+            size + ARENA_ALIGNMENT : memory_arena->block_size;
+
+        block = arena_block_new(new_block_size, block);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+
+        memory_arena->current_block = block;
+        offset = arena_block_aligned_offset(block);
+    }
+
+    block->used = offset + size;
+    memory_arena->last_allocation = block->data + offset;
+
+    return memory_arena->last_allocation;
+}
+
+static void* arena_reallocate(void* const arena, void* const memory, const size_t old_size, const size_t new_size)
+{
+    File_Reader_Arena* const memory_arena = arena;
+
+    if (memory == NULL)
+    {
+        return arena_allocate(arena, new_size);
+    }
+
+    // the last allocation grows in place if there is enough space in block
+    Arena_Block* const block = memory_arena->current_block;
+    if (memory == memory_arena->last_allocation)
+    {
+        const size_t offset = (size_t)((unsigned char*)memory - block->data);
+        if (new_size <= block->size - offset)
+        {
+            block->used = offset + new_size;
+            return memory;
+        }
+    }
+
+    void* const new_memory = arena_allocate(arena, new_size);
+    if (new_memory != NULL)
+    {
+        memcpy(new_memory, memory, old_size < new_size ? old_size : new_size);
+    }
+
+    return new_memory;
+}
+
+static void arena_deallocate(void* const arena, void* const memory)
+{
+    // memory of arena is released only by reset
+    (void)arena;
+    (void)memory;
+}
@@ -0,0 +1,19 @@
+#ifndef FILE_READER_ALLOCATOR_H
+#define FILE_READER_ALLOCATOR_H
+
+#include <file_reader.h>
+
+/*
+    Internal helpers which go through the allocator given in options,
+    allocator without functions (or NULL pointer to it) means malloc, realloc and free.
+*/
+
+void* allocator_allocate(const File_Reader_Allocator* allocator, size_t size);
+void* allocator_allocate_zeroed(const File_Reader_Allocator* allocator, size_t size);
+void* allocator_reallocate(const File_Reader_Allocator* allocator, void* memory, size_t old_size, size_t new_size);
+void  allocator_deallocate(const File_Reader_Allocator* allocator, void* memory);
+
+// memory of one function can't be given to another one, so either all functions are set or none of them
+bool  allocator_is_valid(const File_Reader_Allocator* allocator);
+
+#endif // FILE_READER_ALLOCATOR_H
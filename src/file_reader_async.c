@@ -0,0 +1,349 @@
+#define _GNU_SOURCE // _SC_NPROCESSORS_ONLN
+
+#include <file_reader.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// loads are done by at most that many workers
+#define ASYNC_MAX_NO_OF_THREADS 64
+
+typedef struct Async_Job Async_Job;
+
+struct Async_Job
+{
+    File_Reader_Async_Callback callback;
+    void*                      user_data;
+    File_Reader*               file_reader;  // loaded and indexed reader, NULL on error
+    int                        error;        // errno of failed load, 0 on success
+    Async_Job*                 next;         // next job in the same queue
+    char                       file_name[];
+};
+
+typedef struct Async_Queue
+{
+    Async_Job* first;
+    Async_Job* last;
+} Async_Queue;
+
+/*
+    Workers take jobs from the pending queue and move them to the finished queue, each finished job
+    makes the eventfd readable. Callbacks are called only by file_reader_async_dispatch,
+    so they run in the thread of the event loop which owns the fd.
+*/
+struct File_Reader_Async
+{
+    pthread_mutex_t     mutex;             // guards both queues and is_stopping
+    pthread_cond_t      job_added;         // workers wait for jobs
+    Async_Queue         pending_jobs;
+    Async_Queue         finished_jobs;
+    bool                is_stopping;       // workers exit, pending jobs are cancelled
+    int                 event_fd;          // counter of finished jobs which are not dispatched yet
+    File_Reader_Options options;           // used for every reader
+    size_t              no_of_threads;
+    pthread_t           threads[ASYNC_MAX_NO_OF_THREADS];
+};
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static void queue_push(Async_Queue* queue, Async_Job* job);
+static Async_Job* queue_pop_all(Async_Queue* queue);
+static void finish_job(File_Reader_Async* async, Async_Job* job);
+static void* load_async_files(void* async);
+
+
+/***********************************************************
+ * FILE_READER_H ASYNC API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Files are loaded by no_of_threads workers (0 means number of online CPUs) with options
+    (NULL means defaults), so the thread which submits them never blocks on the disk.
+*/
+File_Reader_Async* file_reader_async_new(size_t no_of_threads, const File_Reader_Options* const options)
+{
+    if (no_of_threads == 0)
+    {
+        const long no_of_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        no_of_threads = no_of_cpus > 0 ? (size_t)no_of_cpus : 1;
+    }
+
+    if (no_of_threads > ASYNC_MAX_NO_OF_THREADS)
+    {
+        no_of_threads = ASYNC_MAX_NO_OF_THREADS;
+    }
+
+    File_Reader_Async* const async = calloc(1, sizeof(*async));
+    if (async == NULL)
+    {
+        return NULL;
+    }
+
+    if (options != NULL)
+    {
+        async->options = *options;
+    }
+    else
+    {
+        file_reader_options_init(&async->options);
+    }
+
+    async->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (async->event_fd == -1)
+    {
+        free(async);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&async->mutex, NULL) != 0)
+    {
+        close(async->event_fd);
+        free(async);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&async->job_added, NULL) != 0)
+    {
+        pthread_mutex_destroy(&async->mutex);
+        close(async->event_fd);
+        free(async);
+        return NULL;
+    }
+
+    // at least one worker is needed, the rest only speed up loading of many files
+    for (size_t i = 0; i < no_of_threads; ++i)
+    {
+        if (pthread_create(&async->threads[async->no_of_threads], NULL, load_async_files, async) == 0)
+        {
+            ++async->no_of_threads;
+        }
+    }
+
+    if (async->no_of_threads == 0)
+    {
+        file_reader_async_delete(async);
+        return NULL;
+    }
+
+    return async;
+}
+
+/*
+    Load the file and build its whole line index in background. Callback gets the reader
+    (it belongs to the callback then) or NULL with errno of failure, it is called by
+    file_reader_async_dispatch. Returns false if the load can't be submitted.
+*/
+bool file_reader_new_async(File_Reader_Async* const async, const char* const file_name,
+                           const File_Reader_Async_Callback callback, void* const user_data)
+{
+    if (async == NULL || file_name == NULL || callback == NULL)
+    {
+        return false;
+    }
+
+    const size_t file_name_size = strlen(file_name) + 1;
+    Async_Job* const job = calloc(1, sizeof(*job) + file_name_size);
+    if (job == NULL)
+    {
+        return false;
+    }
+
+    job->callback = callback;
+    job->user_data = user_data;
+    memcpy(job->file_name, file_name, file_name_size);
+
+    pthread_mutex_lock(&async->mutex);
+    queue_push(&async->pending_jobs, job);
+    pthread_cond_signal(&async->job_added);
+    pthread_mutex_unlock(&async->mutex);
+
+    return true;
+}
+
+/*
+    Descriptor becomes readable when some loads are finished, e.g. for epoll or poll,
+    the loop calls file_reader_async_dispatch then
+*/
+int file_reader_async_get_fd(const File_Reader_Async* const async)
+{
+    if (async == NULL)
+    {
+        return -1;
+    }
+
+    return async->event_fd;
+}
+
+/*
+    Call callbacks of all finished loads in the calling thread, in order of finishing.
+    Returns number of called callbacks.
+*/
+size_t file_reader_async_dispatch(File_Reader_Async* const async)
+{
+    if (async == NULL)
+    {
+        return 0;
+    }
+
+    // counter is reset before the queue is taken, so a load finished meanwhile makes fd readable again
+    uint64_t no_of_events = 0;
+    const ssize_t bytes_read = read(async->event_fd, &no_of_events, sizeof(no_of_events));
+    (void)bytes_read;
+
+    pthread_mutex_lock(&async->mutex);
+    Async_Job* job = queue_pop_all(&async->finished_jobs);
+    pthread_mutex_unlock(&async->mutex);
+
+    size_t no_of_callbacks = 0;
+
+    while (job != NULL)
+    {
+        Async_Job* const next_job = job->next;
+
+        job->callback(job->user_data, job->file_reader, job->error);
+        free(job);
+        ++no_of_callbacks;
+
+        job = next_job;
+    }
+
+    return no_of_callbacks;
+}
+
+/*
+    Loads in progress are finished, loads not started yet are cancelled (ECANCELED).
+    Callbacks of all of them are called before the function returns.
+*/
+void file_reader_async_delete(File_Reader_Async* const async)
+{
+    if (async == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&async->mutex);
+    async->is_stopping = true;
+    pthread_cond_broadcast(&async->job_added);
+    pthread_mutex_unlock(&async->mutex);
+
+    for (size_t i = 0; i < async->no_of_threads; ++i)
+    {
+        pthread_join(async->threads[i], NULL);
+    }
+
+    // workers are gone, so there is no need to lock
+    Async_Job* job = queue_pop_all(&async->pending_jobs);
+
+    while (job != NULL)
+    {
+        Async_Job* const next_job = job->next;
+
+        job->error = ECANCELED;
+        queue_push(&async->finished_jobs, job);
+
+        job = next_job;
+    }
+
+    file_reader_async_dispatch(async);
+
+    pthread_cond_destroy(&async->job_added);
+    pthread_mutex_destroy(&async->mutex);
+    close(async->event_fd);
+    free(async);
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+static void queue_push(Async_Queue* const queue, Async_Job* const job)
+{
+    job->next = NULL;
+
+    if (queue->last != NULL)
+    {
+        queue->last->next = job;
+    }
+    else
+    {
+        queue->first = job;
+    }
+
+    queue->last = job;
+}
+
+static Async_Job* queue_pop_all(Async_Queue* const queue)
+{
+    Async_Job* const first_job = queue->first;
+
+    queue->first = NULL;
+    queue->last = NULL;
+
+    return first_job;
+}
+
+static void finish_job(File_Reader_Async* const async, Async_Job* const job)
+{
+    pthread_mutex_lock(&async->mutex);
+    queue_push(&async->finished_jobs, job);
+    pthread_mutex_unlock(&async->mutex);
+
+    // eventfd counter can't overflow with number of jobs, so write doesn't fail
+    const uint64_t one_event = 1;
+    const ssize_t bytes_written = write(async->event_fd, &one_event, sizeof(one_event));
+    (void)bytes_written;
+}
+
+static void* load_async_files(void* const async)
+{
+    File_Reader_Async* const loader = async;
+
+    while (true)
+    {
+        pthread_mutex_lock(&loader->mutex);
+
+        while (loader->pending_jobs.first == NULL && loader->is_stopping == false)
+        {
+            pthread_cond_wait(&loader->job_added, &loader->mutex);
+        }
+
+        if (loader->is_stopping == true)
+        {
+            pthread_mutex_unlock(&loader->mutex);
+            break;
+        }
+
+        Async_Job* const job = loader->pending_jobs.first;
+        loader->pending_jobs.first = job->next;
+        if (loader->pending_jobs.first == NULL)
+        {
+            loader->pending_jobs.last = NULL;
+        }
+
+        pthread_mutex_unlock(&loader->mutex);
+
+        errno = 0;
+        job->file_reader = file_reader_new_ex(job->file_name, &loader->options);
+
+        if (job->file_reader == NULL)
+        {
+            job->error = errno != 0 ? errno : EIO;
+        }
+        else
+        {
+            // reader is given fully indexed, so the event loop never scans the file
+            file_reader_get_no_of_lines(job->file_reader);
+        }
+
+        finish_job(loader, job);
+    }
+
+    return NULL;
+}
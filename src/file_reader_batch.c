@@ -0,0 +1,109 @@
+#include <file_reader.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+
+// files of batch are loaded by at most that many threads, the calling thread included
+#define BATCH_MAX_NO_OF_THREADS 8
+
+typedef struct Batch
+{
+    const char* const* file_names;
+    File_Reader**      file_readers;
+    int*               errors;     // errno of each slot, 0 for loaded file, NULL if not wanted
+    size_t             no_of_files;
+    size_t             next_file;  // index of the next file to load, taken atomically by workers
+} Batch;
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static void* load_batch_files(void* batch);
+
+
+/***********************************************************
+ * FILE_READER_H BATCH API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Workers take files one by one, so a slow file delays only the worker which loads it.
+    Every slot of file_readers gets its own reader or NULL if the file can't be loaded,
+    the same slot of errors (if it is not NULL) gets 0 or errno of the failure.
+    Returns number of loaded files.
+*/
+size_t file_reader_new_batch(const char* const* const file_names, const size_t no_of_files,
+                             File_Reader** const file_readers, int* const errors)
+{
+    if (file_names == NULL || file_readers == NULL)
+    {
+        return 0;
+    }
+
+    Batch batch = {file_names, file_readers, errors, no_of_files, 0};
+
+    const size_t no_of_threads = no_of_files < BATCH_MAX_NO_OF_THREADS ? no_of_files : BATCH_MAX_NO_OF_THREADS;
+    pthread_t threads[BATCH_MAX_NO_OF_THREADS];
+    bool is_thread_created[BATCH_MAX_NO_OF_THREADS] = {false};
+
+    // the calling thread is one of the workers, if thread can't be created the rest just do more
+    for (size_t i = 1; i < no_of_threads; ++i)
+    {
+        is_thread_created[i] = pthread_create(&threads[i], NULL, load_batch_files, &batch) == 0;
+    }
+
+    load_batch_files(&batch);
+
+    for (size_t i = 1; i < no_of_threads; ++i)
+    {
+        if (is_thread_created[i] == true)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    size_t no_of_loaded_files = 0;
+    for (size_t i = 0; i < no_of_files; ++i)
+    {
+        no_of_loaded_files += (file_readers[i] != NULL);
+    }
+
+    return no_of_loaded_files;
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+static void* load_batch_files(void* const batch)
+{
+    Batch* const files = batch;
+
+    while (true)
+    {
+        const size_t file_index = __atomic_fetch_add(&files->next_file, 1, __ATOMIC_RELAXED);
+        if (file_index >= files->no_of_files)
+        {
+            break;
+        }
+
+        errno = 0;
+        File_Reader* const file_reader = file_reader_new(files->file_names[file_index]);
+        const int error = errno != 0 ? errno : EIO;
+
+        // readers are lazy by default, indexing is a part of work which is spread across workers
+        if (file_reader != NULL)
+        {
+            file_reader_get_no_of_lines(file_reader);
+        }
+
+        files->file_readers[file_index] = file_reader;
+
+        if (files->errors != NULL)
+        {
+            files->errors[file_index] = file_reader != NULL ? 0 : error;
+        }
+    }
+
+    return NULL;
+}
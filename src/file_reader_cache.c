@@ -0,0 +1,499 @@
+#define _DEFAULT_SOURCE // st_mtim
+
+#include <file_reader.h>
+#include "file_reader_identity.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define CACHE_MIN_NO_OF_BUCKETS 64
+
+typedef struct Cache_Entry Cache_Entry;
+
+struct Cache_Entry
+{
+    File_Reader*    file_reader;
+    uint64_t        name_hash;
+    File_Identity   file_identity;     // file which the reader was loaded from, recorded by the reader itself,
+                                       // reader is valid as long as the file name still points to it unchanged
+    size_t          memory_in_bytes;   // buffer and line index of reader, counted in the budget
+    size_t          no_of_references;  // acquires which are not released yet
+    bool            is_stale;          // file has changed, entry goes away with its last reference
+    Cache_Entry*    next_in_bucket;
+    Cache_Entry*    lru_previous;      // entries without references, the most recently released first
+    Cache_Entry*    lru_next;
+    char            name[];
+};
+
+/*
+    Readers are found by file name in the hash table, only entries without references
+    are in the LRU list, so they are the only ones which can be evicted.
+    One mutex guards everything, files are loaded without holding it.
+*/
+struct File_Reader_Cache
+{
+    pthread_mutex_t         mutex;
+    File_Reader_Options     options;          // used for every reader of the cache
+    size_t                  budget_in_bytes;  // memory of readers kept without references
+    Cache_Entry**           buckets;
+    size_t                  no_of_buckets;    // power of 2
+    Cache_Entry*            lru_first;
+    Cache_Entry*            lru_last;
+    File_Reader_Cache_Stats stats;
+};
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static uint64_t hash_name(const char* name);
+static void get_stat_identity(const struct stat* file_stat_buffer, File_Identity* identity);
+static bool is_same_file(const File_Identity* identity, const File_Identity* other_identity);
+static Cache_Entry* cache_find(const File_Reader_Cache* cache, const char* name, uint64_t name_hash);
+static void cache_insert(File_Reader_Cache* cache, Cache_Entry* entry);
+static void cache_remove(File_Reader_Cache* cache, Cache_Entry* entry);
+static void cache_reference(File_Reader_Cache* cache, Cache_Entry* entry);
+static void cache_evict_over_budget(File_Reader_Cache* cache);
+static void lru_push_front(File_Reader_Cache* cache, Cache_Entry* entry);
+static void lru_remove(File_Reader_Cache* cache, Cache_Entry* entry);
+
+
+/***********************************************************
+ * FILE_READER_H CACHE API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Readers which are not acquired are kept while their memory fits into budget_in_bytes,
+    0 means that readers are kept only while they are acquired. Options (NULL means defaults)
+    are used for all readers, allocator has to outlive the cache and be thread safe,
+    because readers are loaded and deleted by all threads which use the cache.
+*/
+File_Reader_Cache* file_reader_cache_new(const size_t budget_in_bytes, const File_Reader_Options* const options)
+{
+    File_Reader_Cache* const cache = calloc(1, sizeof(*cache));
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+
+    cache->buckets = calloc(CACHE_MIN_NO_OF_BUCKETS, sizeof(*cache->buckets));
+    if (cache->buckets == NULL || pthread_mutex_init(&cache->mutex, NULL) != 0)
+    {
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+
+    if (options != NULL)
+    {
+        cache->options = *options;
+    }
+    else
+    {
+        file_reader_options_init(&cache->options);
+    }
+
+    cache->no_of_buckets = CACHE_MIN_NO_OF_BUCKETS;
+    cache->budget_in_bytes = budget_in_bytes;
+
+    return cache;
+}
+
+/*
+    Cached reader of the file if the file has not changed since it was loaded, otherwise
+    the file is loaded again and replaces the old reader, which stays valid until it is released.
+    Reader is shared, so it is immutable. Files without size (e.g. in /proc) are not cached,
+    each acquire gets a new reader. Every acquired reader has to be released.
+*/
+const File_Reader* file_reader_cache_acquire(File_Reader_Cache* const cache, const char* const file_name)
+{
+    if (cache == NULL || file_name == NULL)
+    {
+        return NULL;
+    }
+
+    // file which the name points to now, only to check cached reader against it
+    struct stat file_stat_buffer = {0};
+    if (stat(file_name, &file_stat_buffer) == -1)
+    {
+        //printf("Could not fetch file stats correctly for file \"%s\"\n", file_name);
+        return NULL;
+    }
+
+    File_Identity current_identity;
+    get_stat_identity(&file_stat_buffer, &current_identity);
+
+    const bool may_be_cached = S_ISREG(file_stat_buffer.st_mode) && file_stat_buffer.st_size > 0;
+    const uint64_t name_hash = hash_name(file_name);
+
+    pthread_mutex_lock(&cache->mutex);
+
+    Cache_Entry* const cached_entry = may_be_cached == true ? cache_find(cache, file_name, name_hash) : NULL;
+
+    if (cached_entry != NULL)
+    {
+        if (is_same_file(&cached_entry->file_identity, &current_identity) == true)
+        {
+            cache_reference(cache, cached_entry);
+            ++cache->stats.no_of_hits;
+            pthread_mutex_unlock(&cache->mutex);
+
+            return cached_entry->file_reader;
+        }
+
+        // readers which still use the old content keep it until they release it
+        cached_entry->is_stale = true;
+        if (cached_entry->no_of_references == 0)
+        {
+            cache_remove(cache, cached_entry);
+        }
+    }
+
+    ++cache->stats.no_of_misses;
+    pthread_mutex_unlock(&cache->mutex);
+
+    File_Reader* const file_reader = file_reader_new_ex(file_name, &cache->options);
+    if (file_reader == NULL)
+    {
+        return NULL;
+    }
+
+    // file could be replaced since stat, entry describes the file which was really loaded
+    File_Identity loaded_identity;
+    if (file_reader_get_identity(file_reader, &loaded_identity) == false
+        || S_ISREG(loaded_identity.mode) == false || loaded_identity.size <= 0)
+    {
+        return file_reader;
+    }
+
+    // line index is built now, so its memory is counted and shared readers don't wait for it
+    file_reader_get_no_of_lines(file_reader);
+
+    const size_t name_size = strlen(file_name) + 1;
+    Cache_Entry* const entry = calloc(1, sizeof(*entry) + name_size);
+    if (entry == NULL)
+    {
+        // reader is given anyway, it is just not shared
+        return file_reader;
+    }
+
+    entry->file_reader = file_reader;
+    entry->name_hash = name_hash;
+    entry->file_identity = loaded_identity;
+    entry->memory_in_bytes = file_reader_get_file_size(file_reader) + 1 + file_reader_get_line_index_size(file_reader);
+    memcpy(entry->name, file_name, name_size);
+
+    pthread_mutex_lock(&cache->mutex);
+
+    // another thread could load the same file meanwhile, the first one is shared
+    Cache_Entry* const loaded_entry = cache_find(cache, file_name, name_hash);
+
+    if (loaded_entry != NULL && is_same_file(&loaded_entry->file_identity, &loaded_identity) == true)
+    {
+        cache_reference(cache, loaded_entry);
+        pthread_mutex_unlock(&cache->mutex);
+
+        file_reader_delete(file_reader);
+        free(entry);
+
+        return loaded_entry->file_reader;
+    }
+
+    if (loaded_entry != NULL)
+    {
+        loaded_entry->is_stale = true;
+        if (loaded_entry->no_of_references == 0)
+        {
+            cache_remove(cache, loaded_entry);
+        }
+    }
+
+    entry->no_of_references = 1;
+    cache_insert(cache, entry);
+    cache_evict_over_budget(cache);
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return file_reader;
+}
+
+/*
+    Reader which is not used by anyone is kept for the next acquire within the budget,
+    the least recently released ones are deleted first when the budget is exceeded
+*/
+void file_reader_cache_release(File_Reader_Cache* const cache, const File_Reader* const file_reader)
+{
+    if (cache == NULL || file_reader == NULL)
+    {
+        return;
+    }
+
+    const char* const file_name = file_reader_get_file_name(file_reader);
+    const uint64_t name_hash = hash_name(file_name);
+
+    pthread_mutex_lock(&cache->mutex);
+
+    Cache_Entry* entry = cache->buckets[name_hash & (cache->no_of_buckets - 1)];
+    while (entry != NULL && entry->file_reader != file_reader)
+    {
+        entry = entry->next_in_bucket;
+    }
+
+    if (entry == NULL)
+    {
+        // reader which is not cached belongs only to the caller
+        pthread_mutex_unlock(&cache->mutex);
+        file_reader_delete((File_Reader*)file_reader);
+        return;
+    }
+
+    if (--entry->no_of_references == 0)
+    {
+        if (entry->is_stale == true)
+        {
+            cache_remove(cache, entry);
+        }
+        else
+        {
+            lru_push_front(cache, entry);
+            cache_evict_over_budget(cache);
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+bool file_reader_cache_get_stats(const File_Reader_Cache* const cache, File_Reader_Cache_Stats* const stats)
+{
+    if (cache == NULL || stats == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock((pthread_mutex_t*)&cache->mutex);
+    *stats = cache->stats;
+    pthread_mutex_unlock((pthread_mutex_t*)&cache->mutex);
+
+    return true;
+}
+
+/*
+    All readers of the cache are deleted, also the ones which are not released yet
+*/
+void file_reader_cache_delete(File_Reader_Cache* const cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->no_of_buckets; ++i)
+    {
+        Cache_Entry* entry = cache->buckets[i];
+
+        while (entry != NULL)
+        {
+            Cache_Entry* const next_entry = entry->next_in_bucket;
+            file_reader_delete(entry->file_reader);
+            free(entry);
+            entry = next_entry;
+        }
+    }
+
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache->buckets);
+    free(cache);
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    FNV-1a of name characters
+*/
+static uint64_t hash_name(const char* const name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const char* character = name; *character != '\0'; ++character)
+    {
+        hash = (hash ^ (uint8_t)*character) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static void get_stat_identity(const struct stat* const file_stat_buffer, File_Identity* const identity)
+{
+    identity->device = file_stat_buffer->st_dev;
+    identity->inode = file_stat_buffer->st_ino;
+    identity->mode = file_stat_buffer->st_mode;
+    identity->size = file_stat_buffer->st_size;
+    identity->mtime = file_stat_buffer->st_mtim;
+}
+
+/*
+    The same file with the same size and modification time
+*/
+static bool is_same_file(const File_Identity* const identity, const File_Identity* const other_identity)
+{
+    return identity->device == other_identity->device
+           && identity->inode == other_identity->inode
+           && identity->size == other_identity->size
+           && identity->mtime.tv_sec == other_identity->mtime.tv_sec
+           && identity->mtime.tv_nsec == other_identity->mtime.tv_nsec;
+}
+
+/*
+    Entry of the file which is not stale, there is at most one such entry for a name
+*/
+static Cache_Entry* cache_find(const File_Reader_Cache* const cache, const char* const name, const uint64_t name_hash)
+{
+    Cache_Entry* entry = cache->buckets[name_hash & (cache->no_of_buckets - 1)];
+
+    while (entry != NULL)
+    {
+        if (entry->is_stale == false && entry->name_hash == name_hash && strcmp(entry->name, name) == 0)
+        {
+            return entry;
+        }
+
+        entry = entry->next_in_bucket;
+    }
+
+    return NULL;
+}
+
+/*
+    Table is doubled when it has more entries than buckets, if it can't be enlarged chains just get longer
+*/
+static void cache_insert(File_Reader_Cache* const cache, Cache_Entry* const entry)
+{
+    if (cache->stats.no_of_readers >= cache->no_of_buckets)
+    {
+        const size_t new_no_of_buckets = cache->no_of_buckets * 2;
+        Cache_Entry** const new_buckets = calloc(new_no_of_buckets, sizeof(*new_buckets));
+
+        if (new_buckets != NULL)
+        {
+            for (size_t i = 0; i < cache->no_of_buckets; ++i)
+            {
+                Cache_Entry* moved_entry = cache->buckets[i];
+
+                while (moved_entry != NULL)
+                {
+                    Cache_Entry* const next_entry = moved_entry->next_in_bucket;
+                    Cache_Entry** const bucket = &new_buckets[moved_entry->name_hash & (new_no_of_buckets - 1)];
+
+                    moved_entry->next_in_bucket = *bucket;
+                    *bucket = moved_entry;
+                    moved_entry = next_entry;
+                }
+            }
+
+            free(cache->buckets);
+            cache->buckets = new_buckets;
+            cache->no_of_buckets = new_no_of_buckets;
+        }
+    }
+
+    Cache_Entry** const bucket = &cache->buckets[entry->name_hash & (cache->no_of_buckets - 1)];
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+
+    ++cache->stats.no_of_readers;
+    cache->stats.memory_in_bytes += entry->memory_in_bytes;
+}
+
+/*
+    Entry without references is unlinked and deleted together with its reader
+*/
+static void cache_remove(File_Reader_Cache* const cache, Cache_Entry* const entry)
+{
+    Cache_Entry** link = &cache->buckets[entry->name_hash & (cache->no_of_buckets - 1)];
+    while (*link != entry)
+    {
+        link = &(*link)->next_in_bucket;
+    }
+    *link = entry->next_in_bucket;
+
+    lru_remove(cache, entry);
+
+    --cache->stats.no_of_readers;
+    cache->stats.memory_in_bytes -= entry->memory_in_bytes;
+
+    file_reader_delete(entry->file_reader);
+    free(entry);
+}
+
+static void cache_reference(File_Reader_Cache* const cache, Cache_Entry* const entry)
+{
+    if (entry->no_of_references == 0)
+    {
+        lru_remove(cache, entry);
+    }
+
+    ++entry->no_of_references;
+}
+
+static void cache_evict_over_budget(File_Reader_Cache* const cache)
+{
+    while (cache->stats.memory_in_bytes > cache->budget_in_bytes && cache->lru_last != NULL)
+    {
+        cache_remove(cache, cache->lru_last);
+        ++cache->stats.no_of_evictions;
+    }
+}
+
+static void lru_push_front(File_Reader_Cache* const cache, Cache_Entry* const entry)
+{
+    entry->lru_previous = NULL;
+    entry->lru_next = cache->lru_first;
+
+    if (cache->lru_first != NULL)
+    {
+        cache->lru_first->lru_previous = entry;
+    }
+    else
+    {
+        cache->lru_last = entry;
+    }
+
+    cache->lru_first = entry;
+}
+
+/*
+    Entry which is not in the list (it has references) is left as it is
+*/
+static void lru_remove(File_Reader_Cache* const cache, Cache_Entry* const entry)
+{
+    if (entry->lru_previous == NULL && cache->lru_first != entry)
+    {
+        return;
+    }
+
+    if (entry->lru_previous != NULL)
+    {
+        entry->lru_previous->lru_next = entry->lru_next;
+    }
+    else
+    {
+        cache->lru_first = entry->lru_next;
+    }
+
+    if (entry->lru_next != NULL)
+    {
+        entry->lru_next->lru_previous = entry->lru_previous;
+    }
+    else
+    {
+        cache->lru_last = entry->lru_previous;
+    }
+
+    entry->lru_previous = NULL;
+    entry->lru_next = NULL;
+}
@@ -0,0 +1,413 @@
+#define _DEFAULT_SOURCE // pread
+
+#include "file_reader_decompressor.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef FILE_READER_WITH_ZLIB
+#include <limits.h>
+#include <zlib.h>
+#endif
+
+#ifdef FILE_READER_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+// compressed file is read in such parts
+#define DECOMPRESSOR_INPUT_SIZE (64 * 1024)
+
+#define GZIP_TRAILER_SIZE 8
+#define GZIP_MIN_FILE_SIZE 18
+
+struct Decompressor
+{
+    Compression_Format format;
+    int                fd;                 // descriptor of compressed file, owned by the caller
+    bool               is_input_eof;       // whole compressed file has been read
+    bool               is_finished;        // whole content has been decompressed
+    bool               has_content_size;   // format gave the size of content
+    size_t             content_size;
+#ifdef FILE_READER_WITH_ZLIB
+    z_stream           zlib_stream;
+    bool               is_member_end;      // gzip member has ended, the next one may follow it
+#endif
+#ifdef FILE_READER_WITH_ZSTD
+    ZSTD_DStream*      zstd_stream;
+    ZSTD_inBuffer      zstd_input;
+    bool               is_frame_end;       // zstd frame has ended, the next one may follow it
+#endif
+    size_t             input_size;         // bytes of compressed file in input
+    unsigned char      input[DECOMPRESSOR_INPUT_SIZE];
+};
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+#if defined(FILE_READER_WITH_ZLIB) || defined(FILE_READER_WITH_ZSTD)
+static bool fill_input(Decompressor* decompressor);
+#endif
+#ifdef FILE_READER_WITH_ZLIB
+static bool gzip_open(Decompressor* decompressor);
+static bool gzip_read(Decompressor* decompressor, char* buffer, size_t size, size_t* bytes_read);
+#endif
+#ifdef FILE_READER_WITH_ZSTD
+static bool zstd_open(Decompressor* decompressor);
+static bool zstd_read(Decompressor* decompressor, char* buffer, size_t size, size_t* bytes_read);
+#endif
+
+
+/***********************************************************
+ * FILE_READER_DECOMPRESSOR_H FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Magic bytes are read by pread, so pipes (which can't be read twice) are never compressed
+*/
+Compression_Format compression_detect_format(const int fd)
+{
+    unsigned char magic[4] = {0};
+    ssize_t bytes_read = 0;
+
+    do
+    {
+        bytes_read = pread(fd, magic, sizeof(magic), 0);
+    } while (bytes_read == -1 && errno == EINTR);
+
+    Compression_Format format = COMPRESSION_FORMAT_NONE;
+
+#ifdef FILE_READER_WITH_ZLIB
+    if (bytes_read >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        format = COMPRESSION_FORMAT_GZIP;
+    }
+#endif
+#ifdef FILE_READER_WITH_ZSTD
+    if (bytes_read >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+    {
+        format = COMPRESSION_FORMAT_ZSTD;
+    }
+#endif
+
+    (void)magic;
+    (void)bytes_read;
+
+    return format;
+}
+
+Decompressor* decompressor_open(const int fd, const Compression_Format format)
+{
+    if (fd == -1 || format == COMPRESSION_FORMAT_NONE)
+    {
+        return NULL;
+    }
+
+    Decompressor* const decompressor = calloc(1, sizeof(*decompressor));
+    if (decompressor == NULL)
+    {
+        return NULL;
+    }
+
+    decompressor->format = format;
+    decompressor->fd = fd;
+
+    bool is_opened = false;
+
+    switch (format)
+    {
+#ifdef FILE_READER_WITH_ZLIB
+        case COMPRESSION_FORMAT_GZIP:
+            is_opened = gzip_open(decompressor);
+            break;
+#endif
+#ifdef FILE_READER_WITH_ZSTD
+        case COMPRESSION_FORMAT_ZSTD:
+            is_opened = zstd_open(decompressor);
+            break;
+#endif
+        case COMPRESSION_FORMAT_NONE:
+        default:
+            break;
+    }
+
+    if (is_opened == false)
+    {
+        free(decompressor);
+        return NULL;
+    }
+
+    return decompressor;
+}
+
+bool decompressor_get_content_size(const Decompressor* const decompressor, size_t* const content_size)
+{
+    if (decompressor == NULL || content_size == NULL || decompressor->has_content_size == false)
+    {
+        return false;
+    }
+
+    *content_size = decompressor->content_size;
+
+    return true;
+}
+
+bool decompressor_read(Decompressor* const decompressor, char* const buffer, const size_t size,
+                       size_t* const bytes_read)
+{
+    if (decompressor == NULL || buffer == NULL || bytes_read == NULL)
+    {
+        return false;
+    }
+
+    *bytes_read = 0;
+    (void)size;
+
+    switch (decompressor->format)
+    {
+#ifdef FILE_READER_WITH_ZLIB
+        case COMPRESSION_FORMAT_GZIP:
+            return gzip_read(decompressor, buffer, size, bytes_read);
+#endif
+#ifdef FILE_READER_WITH_ZSTD
+        case COMPRESSION_FORMAT_ZSTD:
+            return zstd_read(decompressor, buffer, size, bytes_read);
+#endif
+        case COMPRESSION_FORMAT_NONE:
+        default:
+            return false;
+    }
+}
+
+void decompressor_close(Decompressor* const decompressor)
+{
+    if (decompressor == NULL)
+    {
+        return;
+    }
+
+#ifdef FILE_READER_WITH_ZLIB
+    if (decompressor->format == COMPRESSION_FORMAT_GZIP)
+    {
+        inflateEnd(&decompressor->zlib_stream);
+    }
+#endif
+#ifdef FILE_READER_WITH_ZSTD
+    if (decompressor->format == COMPRESSION_FORMAT_ZSTD)
+    {
+        ZSTD_freeDStream(decompressor->zstd_stream);
+    }
+#endif
+
+    free(decompressor);
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+#if defined(FILE_READER_WITH_ZLIB) || defined(FILE_READER_WITH_ZSTD)
+/*
+    Read the next part of compressed file to input, returns false only on read error
+*/
+static bool fill_input(Decompressor* const decompressor)
+{
+    while (true)
+    {
+        const ssize_t bytes_read = read(decompressor->fd, decompressor->input, sizeof(decompressor->input));
+
+        if (bytes_read == -1)
+        {
+            // interrupted read is just repeated
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        decompressor->input_size = (size_t)bytes_read;
+        decompressor->is_input_eof = bytes_read == 0;
+
+        return true;
+    }
+}
+#endif
+
+#ifdef FILE_READER_WITH_ZLIB
+/*
+    Size of content is taken from the trailer of the last gzip member (ISIZE, size modulo 2^32),
+    it is exact for files with one member smaller than 4 GB
+*/
+static bool gzip_open(Decompressor* const decompressor)
+{
+    // 15 bits window, +32 recognizes gzip header
+    if (inflateInit2(&decompressor->zlib_stream, 15 + 32) != Z_OK)
+    {
+        return false;
+    }
+
+    struct stat file_stat_buffer = {0};
+    unsigned char trailer[GZIP_TRAILER_SIZE] = {0};
+
+    if (fstat(decompressor->fd, &file_stat_buffer) == 0 && S_ISREG(file_stat_buffer.st_mode)
+        && file_stat_buffer.st_size >= GZIP_MIN_FILE_SIZE
+        && pread(decompressor->fd, trailer, sizeof(trailer), file_stat_buffer.st_size - GZIP_TRAILER_SIZE)
+           == (ssize_t)sizeof(trailer))
+    {
+        decompressor->content_size = (size_t)trailer[4] | (size_t)trailer[5] << 8
+                                     | (size_t)trailer[6] << 16 | (size_t)trailer[7] << 24;
+        decompressor->has_content_size = true;
+    }
+
+    return true;
+}
+
+/*
+    Concatenated gzip members are decompressed one after another, as gzip tool does
+*/
+static bool gzip_read(Decompressor* const decompressor, char* const buffer, const size_t size,
+                      size_t* const bytes_read)
+{
+    z_stream* const zlib_stream = &decompressor->zlib_stream;
+    size_t bytes_decompressed = 0;
+
+    while (bytes_decompressed < size && decompressor->is_finished == false)
+    {
+        if (zlib_stream->avail_in == 0 && decompressor->is_input_eof == false)
+        {
+            if (fill_input(decompressor) == false)
+            {
+                return false;
+            }
+
+            zlib_stream->next_in = decompressor->input;
+            zlib_stream->avail_in = (uInt)decompressor->input_size;
+        }
+
+        if (zlib_stream->avail_in == 0 && decompressor->is_input_eof == true)
+        {
+            // file may end only after the whole member, otherwise it is truncated
+            if (decompressor->is_member_end == false)
+            {
+                return false;
+            }
+
+            decompressor->is_finished = true;
+            break;
+        }
+
+        if (decompressor->is_member_end == true)
+        {
+            inflateReset(zlib_stream);
+            decompressor->is_member_end = false;
+        }
+
+        const size_t space = size - bytes_decompressed;
+        const uInt space_for_inflate = space < UINT_MAX ? (uInt)space : UINT_MAX;
+
+        zlib_stream->next_out = (Bytef*)buffer + bytes_decompressed;
+        zlib_stream->avail_out = space_for_inflate;
+
+        const int result = inflate(zlib_stream, Z_NO_FLUSH);
+        bytes_decompressed += space_for_inflate - zlib_stream->avail_out;
+
+        if (result == Z_STREAM_END)
+        {
+            decompressor->is_member_end = true;
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+            //printf("Compressed file is damaged\n");
+            return false;
+        }
+    }
+
+    *bytes_read = bytes_decompressed;
+
+    return true;
+}
+#endif
+
+#ifdef FILE_READER_WITH_ZSTD
+/*
+    Size of content is taken from the header of the first frame, if the compressor stored it there
+*/
+static bool zstd_open(Decompressor* const decompressor)
+{
+    decompressor->zstd_stream = ZSTD_createDStream();
+    if (decompressor->zstd_stream == NULL)
+    {
+        return false;
+    }
+
+    if (ZSTD_isError(ZSTD_initDStream(decompressor->zstd_stream)) || fill_input(decompressor) == false)
+    {
+        ZSTD_freeDStream(decompressor->zstd_stream);
+        return false;
+    }
+
+    decompressor->zstd_input = (ZSTD_inBuffer){decompressor->input, decompressor->input_size, 0};
+
+    const unsigned long long content_size = ZSTD_getFrameContentSize(decompressor->input, decompressor->input_size);
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR
+        && content_size <= SIZE_MAX)
+    {
+        decompressor->content_size = (size_t)content_size;
+        decompressor->has_content_size = true;
+    }
+
+    return true;
+}
+
+static bool zstd_read(Decompressor* const decompressor, char* const buffer, const size_t size,
+                      size_t* const bytes_read)
+{
+    ZSTD_inBuffer* const input = &decompressor->zstd_input;
+    ZSTD_outBuffer output = {buffer, size, 0};
+
+    while (output.pos < output.size && decompressor->is_finished == false)
+    {
+        if (input->pos == input->size && decompressor->is_input_eof == false)
+        {
+            if (fill_input(decompressor) == false)
+            {
+                return false;
+            }
+
+            *input = (ZSTD_inBuffer){decompressor->input, decompressor->input_size, 0};
+        }
+
+        if (input->pos == input->size && decompressor->is_input_eof == true)
+        {
+            // file may end only after the whole frame, otherwise it is truncated
+            if (decompressor->is_frame_end == false)
+            {
+                return false;
+            }
+
+            decompressor->is_finished = true;
+            break;
+        }
+
+        const size_t result = ZSTD_decompressStream(decompressor->zstd_stream, &output, input);
+
+        if (ZSTD_isError(result))
+        {
+            //printf("Compressed file is damaged\n");
+            return false;
+        }
+
+        // 0 means that the frame is complete and all its content is flushed
+        decompressor->is_frame_end = result == 0;
+    }
+
+    *bytes_read = output.pos;
+
+    return true;
+}
+#endif
@@ -0,0 +1,42 @@
+#ifndef FILE_READER_DECOMPRESSOR_H
+#define FILE_READER_DECOMPRESSOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+    Internal interface of decompression of compressed files, shared by the reader and the stream.
+    Formats are optional build-time features: FILE_READER_WITH_ZLIB (gzip) and FILE_READER_WITH_ZSTD,
+    files in formats which are not compiled in are read as they are.
+*/
+
+typedef enum Compression_Format
+{
+    COMPRESSION_FORMAT_NONE,
+    COMPRESSION_FORMAT_GZIP,
+    COMPRESSION_FORMAT_ZSTD
+} Compression_Format;
+
+typedef struct Decompressor Decompressor;
+
+// format recognized by magic bytes at the beginning of the file, offset of descriptor is not changed
+Compression_Format compression_detect_format(int fd);
+
+// decompressor reads from the current offset of descriptor, it doesn't own the descriptor
+Decompressor* decompressor_open(int fd, Compression_Format format);
+
+/*
+    Size of decompressed content if the format stores it, e.g. in the gzip trailer
+    or in the zstd frame header. It is only a hint, content may turn out to be longer or shorter.
+*/
+bool decompressor_get_content_size(const Decompressor* decompressor, size_t* content_size);
+
+/*
+    Decompress up to size bytes, less only at the end of content.
+    Returns false when the file is damaged or can't be read.
+*/
+bool decompressor_read(Decompressor* decompressor, char* buffer, size_t size, size_t* bytes_read);
+
+void decompressor_close(Decompressor* decompressor);
+
+#endif // FILE_READER_DECOMPRESSOR_H
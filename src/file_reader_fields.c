@@ -0,0 +1,384 @@
+#include <file_reader.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FIELDS_HAS_X86_SCANNER 1
+#include <immintrin.h>
+#else
+#define FIELDS_HAS_X86_SCANNER 0
+#endif
+
+// 8 digits are converted at once, it needs bytes of uint64_t in order of characters
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define FIELDS_HAS_SWAR_DIGITS 1
+#else
+#define FIELDS_HAS_SWAR_DIGITS 0
+#endif
+
+#define FIELDS_MAX_NO_OF_VECTOR_DELIMITERS (sizeof(((File_Reader_Delimiters*)NULL)->characters))
+
+// uint64_t has 20 digits at most, number of 19 digits can't overflow it
+#define FIELDS_MAX_NO_OF_SAFE_DIGITS 19
+
+// whitespace of /proc files and of most columnar text, used when no delimiters are given
+static const File_Reader_Delimiters whitespace_delimiters =
+{
+    {[' '] = 1, ['\t'] = 1, ['\r'] = 1, ['\v'] = 1, ['\f'] = 1},
+    {' ', '\t', '\r', '\v', '\f'},
+    5,
+    true
+};
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static size_t find_delimiter(const char* data, size_t begin, size_t end,
+                             const File_Reader_Delimiters* delimiters, bool is_delimiter_wanted);
+#if FIELDS_HAS_X86_SCANNER
+static size_t find_delimiter_avx2(const char* data, size_t begin, size_t end,
+                                  const File_Reader_Delimiters* delimiters, bool is_delimiter_wanted);
+#endif
+static bool parse_digits(const char* digits, size_t no_of_digits, uint64_t* value);
+#if FIELDS_HAS_SWAR_DIGITS
+static bool parse_eight_digits(const char* digits, uint64_t* value);
+#endif
+
+
+/***********************************************************
+ * FILE_READER_H FIELDS API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Delimiters are the characters of string, NULL means whitespace (space, \t, \r, \v, \f).
+    Up to 8 different delimiters are found by vectorized scan, bigger sets by lookup table.
+*/
+void file_reader_delimiters_init(File_Reader_Delimiters* const delimiters, const char* const characters,
+                                 const bool collapse)
+{
+    if (delimiters == NULL)
+    {
+        return;
+    }
+
+    if (characters == NULL)
+    {
+        *delimiters = whitespace_delimiters;
+        delimiters->collapse = collapse;
+        return;
+    }
+
+    memset(delimiters, 0, sizeof(*delimiters));
+    delimiters->collapse = collapse;
+
+    size_t no_of_characters = 0;
+
+    for (const char* character = characters; *character != '\0'; ++character)
+    {
+        const uint8_t index = (uint8_t)*character;
+
+        // repeated character is in the set only once
+        if (delimiters->is_delimiter[index] == 1)
+        {
+            continue;
+        }
+
+        delimiters->is_delimiter[index] = 1;
+
+        if (no_of_characters < FIELDS_MAX_NO_OF_VECTOR_DELIMITERS)
+        {
+            delimiters->characters[no_of_characters] = *character;
+        }
+
+        ++no_of_characters;
+    }
+
+    delimiters->no_of_characters = no_of_characters <= FIELDS_MAX_NO_OF_VECTOR_DELIMITERS ? no_of_characters : 0;
+}
+
+/*
+    Fields are views of the line, nothing is copied or modified. Line with collapsed delimiters only
+    has no fields, otherwise each delimiter ends one field, so empty line has one empty field.
+    '\n' which ends the last line of file is not a part of its last field.
+    Returns number of stored fields.
+*/
+size_t file_reader_split_line(const File_Reader_Line_View line_view, const File_Reader_Delimiters* const delimiters,
+                              File_Reader_Line_View* const fields, const size_t max_no_of_fields)
+{
+    if (line_view.data == NULL || fields == NULL || max_no_of_fields == 0)
+    {
+        return 0;
+    }
+
+    const File_Reader_Delimiters* const used_delimiters = delimiters != NULL ? delimiters : &whitespace_delimiters;
+    const bool collapse = used_delimiters->collapse;
+    const char* const data = line_view.data;
+    const size_t end = line_view.len - (line_view.len > 0 && data[line_view.len - 1] == '\n' ? 1 : 0);
+
+    size_t no_of_fields = 0;
+    size_t position = collapse == true ? find_delimiter(data, 0, end, used_delimiters, false) : 0;
+
+    while (no_of_fields < max_no_of_fields && (collapse == false || position < end))
+    {
+        const size_t field_end = find_delimiter(data, position, end, used_delimiters, true);
+        fields[no_of_fields++] = (File_Reader_Line_View){data + position, field_end - position};
+
+        if (field_end == end)
+        {
+            break;
+        }
+
+        position = field_end + 1;
+
+        if (collapse == true)
+        {
+            position = find_delimiter(data, position, end, used_delimiters, false);
+        }
+    }
+
+    return no_of_fields;
+}
+
+size_t file_reader_get_fields(const File_Reader* const file_reader, const size_t line,
+                              const File_Reader_Delimiters* const delimiters,
+                              File_Reader_Line_View* const fields, const size_t max_no_of_fields)
+{
+    return file_reader_split_line(file_reader_get_line_view(file_reader, line), delimiters, fields, max_no_of_fields);
+}
+
+/*
+    Fields of each line are stored in the same array and given to the callback,
+    so lines of any number are split without allocation. Stops at the last line of file.
+    Returns number of lines given to the callback.
+*/
+size_t file_reader_get_fields_each(const File_Reader* const file_reader, const size_t first_line,
+                                   const size_t no_of_lines, const File_Reader_Delimiters* const delimiters,
+                                   File_Reader_Line_View* const fields, const size_t max_no_of_fields,
+                                   const File_Reader_Fields_Callback callback, void* const context)
+{
+    if (file_reader == NULL || fields == NULL || max_no_of_fields == 0 || callback == NULL)
+    {
+        return 0;
+    }
+
+    size_t lines_split = 0;
+
+    while (lines_split < no_of_lines)
+    {
+        const size_t line = first_line + lines_split;
+        const File_Reader_Line_View line_view = file_reader_get_line_view(file_reader, line);
+
+        if (line_view.data == NULL)
+        {
+            break;
+        }
+
+        const size_t no_of_fields = file_reader_split_line(line_view, delimiters, fields, max_no_of_fields);
+        ++lines_split;
+
+        if (callback(context, line, fields, no_of_fields) == false)
+        {
+            break;
+        }
+    }
+
+    return lines_split;
+}
+
+/*
+    Whole field has to be a decimal number without sign, value is set only if it fits uint64_t
+*/
+bool file_reader_parse_uint(const File_Reader_Line_View field, uint64_t* const value)
+{
+    if (field.data == NULL || value == NULL)
+    {
+        return false;
+    }
+
+    return parse_digits(field.data, field.len, value);
+}
+
+/*
+    Whole field has to be a decimal number with optional sign, value is set only if it fits int64_t
+*/
+bool file_reader_parse_int(const File_Reader_Line_View field, int64_t* const value)
+{
+    if (field.data == NULL || field.len == 0 || value == NULL)
+    {
+        return false;
+    }
+
+    const bool is_negative = field.data[0] == '-';
+    const size_t sign_length = (is_negative == true || field.data[0] == '+') ? 1 : 0;
+    const uint64_t min_magnitude = (uint64_t)INT64_MAX + 1;
+
+    uint64_t magnitude = 0;
+    if (parse_digits(field.data + sign_length, field.len - sign_length, &magnitude) == false)
+    {
+        return false;
+    }
+
+    if (magnitude > (is_negative == true ? min_magnitude : (uint64_t)INT64_MAX))
+    {
+        return false;
+    }
+
+    // -INT64_MIN doesn't fit int64_t, so it is not negated
+    if (is_negative == true)
+    {
+        *value = magnitude == min_magnitude ? INT64_MIN : -(int64_t)magnitude;
+    }
+    else
+    {
+        *value = (int64_t)magnitude;
+    }
+
+    return true;
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Returns the first position in [begin, end) which is (or is not) a delimiter, end if there is none
+*/
+static size_t find_delimiter(const char* const data, size_t begin, const size_t end,
+                             const File_Reader_Delimiters* const delimiters, const bool is_delimiter_wanted)
+{
+#if FIELDS_HAS_X86_SCANNER
+    if (delimiters->no_of_characters > 0 && __builtin_cpu_supports("avx2"))
+    {
+        begin = find_delimiter_avx2(data, begin, end, delimiters, is_delimiter_wanted);
+    }
+#endif
+
+    while (begin < end && (delimiters->is_delimiter[(uint8_t)data[begin]] == 1) != is_delimiter_wanted)
+    {
+        ++begin;
+    }
+
+    return begin;
+}
+
+#if FIELDS_HAS_X86_SCANNER
+/*
+    32 characters are compared with all delimiters at once. Returns the found position
+    or the first position which is not checked, rest of range is left for the scalar scan.
+*/
+__attribute__((target("avx2")))
+static size_t find_delimiter_avx2(const char* const data, const size_t begin, const size_t end,
+                                  const File_Reader_Delimiters* const delimiters, const bool is_delimiter_wanted)
+{
+    __m256i delimiter_characters[FIELDS_MAX_NO_OF_VECTOR_DELIMITERS];
+    const size_t no_of_characters = delimiters->no_of_characters;
+
+    for (size_t i = 0; i < no_of_characters; ++i)
+    {
+        delimiter_characters[i] = _mm256_set1_epi8(delimiters->characters[i]);
+    }
+
+    size_t position = begin;
+
+    while (position + 32 <= end)
+    {
+        const __m256i block = _mm256_loadu_si256((const __m256i*)(const void*)(data + position));
+        __m256i is_delimiter = _mm256_cmpeq_epi8(block, delimiter_characters[0]);
+
+        for (size_t i = 1; i < no_of_characters; ++i)
+        {
+            is_delimiter = _mm256_or_si256(is_delimiter, _mm256_cmpeq_epi8(block, delimiter_characters[i]));
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(is_delimiter);
+        if (is_delimiter_wanted == false)
+        {
+            mask = ~mask;
+        }
+
+        if (mask != 0)
+        {
+            return position + (size_t)__builtin_ctz(mask);
+        }
+
+        position += 32;
+    }
+
+    return position;
+}
+#endif
+
+static bool parse_digits(const char* const digits, const size_t no_of_digits, uint64_t* const value)
+{
+    if (no_of_digits == 0)
+    {
+        return false;
+    }
+
+    uint64_t result = 0;
+    size_t position = 0;
+
+#if FIELDS_HAS_SWAR_DIGITS
+    // parts of 8 digits can't overflow while the number has at most 19 digits
+    while (position + 8 <= no_of_digits && position + 8 <= FIELDS_MAX_NO_OF_SAFE_DIGITS)
+    {
+        uint64_t eight_digits = 0;
+        if (parse_eight_digits(digits + position, &eight_digits) == false)
+        {
+            return false;
+        }
+
+        result = result * 100000000u + eight_digits;
+        position += 8;
+    }
+#endif
+
+    for (; position < no_of_digits; ++position)
+    {
+        const unsigned digit = (unsigned)((uint8_t)digits[position] - (uint8_t)'0');
+
+        if (digit > 9 || result > (UINT64_MAX - digit) / 10)
+        {
+            return false;
+        }
+
+        result = result * 10 + digit;
+    }
+
+    *value = result;
+
+    return true;
+}
+
+#if FIELDS_HAS_SWAR_DIGITS
+/*
+    8 characters are checked and converted as one 64-bit word,
+    pairs of digits are joined first, then pairs of pairs and so on
+*/
+static bool parse_eight_digits(const char* const digits, uint64_t* const value)
+{
+    uint64_t word = 0;
+    memcpy(&word, digits, sizeof(word));
+
+    // each byte is '0'-'9' when its high half is 3 and adding 6 to its low half doesn't carry
+    const uint64_t high_halves = word & 0xF0F0F0F0F0F0F0F0u;
+    const uint64_t carries = ((word + 0x0606060606060606u) & 0xF0F0F0F0F0F0F0F0u) >> 4;
+
+    if ((high_halves | carries) != 0x3333333333333333u)
+    {
+        return false;
+    }
+
+    word -= 0x3030303030303030u;
+    word = word * 10 + (word >> 8);
+    word = (((word & 0x000000FF000000FFu) * (100 + (1000000ull << 32)))
+            + (((word >> 16) & 0x000000FF000000FFu) * (1 + (10000ull << 32)))) >> 32;
+
+    *value = (uint32_t)word;
+
+    return true;
+}
+#endif
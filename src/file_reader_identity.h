@@ -0,0 +1,25 @@
+#ifndef FILE_READER_IDENTITY_H
+#define FILE_READER_IDENTITY_H
+
+#include <file_reader.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/*
+    Internal interface for modules which keep readers for later use, e.g. the cache.
+    Identity comes from fstat of the descriptor which the content was read from,
+    so it describes the loaded content even if the file name points to another file meanwhile.
+*/
+typedef struct File_Identity
+{
+    dev_t           device;
+    ino_t           inode;
+    mode_t          mode;
+    off_t           size;    // size of file, not of its content (e.g. of compressed file)
+    struct timespec mtime;
+} File_Identity;
+
+bool file_reader_get_identity(const File_Reader* file_reader, File_Identity* identity);
+
+#endif // FILE_READER_IDENTITY_H
@@ -0,0 +1,231 @@
+#include "file_reader_kv_index.h"
+#include "file_reader_allocator.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define KV_INDEX_MIN_CAPACITY 64
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static uint64_t hash_key(const char* key, size_t key_length);
+static bool is_blank(char character);
+static void trim_blanks(const char* buffer, size_t* begin, size_t* end);
+static bool kv_index_grow(Kv_Index* kv_index, const File_Reader_Allocator* allocator);
+static Kv_Index_Entry* kv_index_find_slot(const Kv_Index* kv_index, const char* buffer, uint64_t hash,
+                                          const char* key, size_t key_length);
+
+
+/***********************************************************
+ * FILE_READER_KV_INDEX_H FUNCTIONS DEFINITIONS
+***********************************************************/
+
+bool kv_index_build(Kv_Index* const kv_index, const char* const buffer, const size_t size, const char separator,
+                    const File_Reader_Allocator* const allocator)
+{
+    if (kv_index == NULL || buffer == NULL)
+    {
+        return false;
+    }
+
+    kv_index_clear(kv_index);
+
+    if (kv_index->capacity > 0)
+    {
+        memset(kv_index->entries, 0, kv_index->capacity * sizeof(*kv_index->entries));
+    }
+
+    size_t line_begin = 0;
+
+    while (line_begin < size)
+    {
+        const char* const new_line = memchr(buffer + line_begin, '\n', size - line_begin);
+        const size_t line_end = new_line != NULL ? (size_t)(new_line - buffer) : size;
+        const char* const separator_position = memchr(buffer + line_begin, separator, line_end - line_begin);
+
+        if (separator_position != NULL)
+        {
+            size_t key_begin = line_begin;
+            size_t key_end = (size_t)(separator_position - buffer);
+            size_t value_begin = key_end + 1;
+            size_t value_end = line_end;
+
+            trim_blanks(buffer, &key_begin, &key_end);
+            trim_blanks(buffer, &value_begin, &value_end);
+
+            const size_t key_length = key_end - key_begin;
+            const uint64_t hash = hash_key(buffer + key_begin, key_length);
+
+            // table is enlarged before it gets more than half full, so probing stays short
+            if (key_length > 0 && (kv_index->no_of_keys + 1) * 2 > kv_index->capacity
+                && kv_index_grow(kv_index, allocator) == false)
+            {
+                return false;
+            }
+
+            Kv_Index_Entry* const entry = key_length > 0 ?
+                kv_index_find_slot(kv_index, buffer, hash, buffer + key_begin, key_length) : NULL;
+
+            if (entry != NULL && entry->key_length == 0)
+            {
+                *entry = (Kv_Index_Entry){hash, key_begin, key_length, value_begin, value_end - value_begin};
+                ++kv_index->no_of_keys;
+            }
+        }
+
+        line_begin = line_end + 1;
+    }
+
+    return true;
+}
+
+bool kv_index_find(const Kv_Index* const kv_index, const char* const buffer, const char* const key,
+                   const size_t key_length, File_Reader_Line_View* const value)
+{
+    if (kv_index == NULL || buffer == NULL || key == NULL || value == NULL
+        || kv_index->no_of_keys == 0 || key_length == 0)
+    {
+        return false;
+    }
+
+    const Kv_Index_Entry* const entry =
+        kv_index_find_slot(kv_index, buffer, hash_key(key, key_length), key, key_length);
+
+    if (entry->key_length == 0)
+    {
+        return false;
+    }
+
+    *value = (File_Reader_Line_View){buffer + entry->value_offset, entry->value_length};
+
+    return true;
+}
+
+void kv_index_clear(Kv_Index* const kv_index)
+{
+    if (kv_index == NULL)
+    {
+        return;
+    }
+
+    kv_index->no_of_keys = 0;
+}
+
+void kv_index_release(Kv_Index* const kv_index, const File_Reader_Allocator* const allocator)
+{
+    if (kv_index == NULL)
+    {
+        return;
+    }
+
+    if (kv_index->entries != NULL)
+    {
+        allocator_deallocate(allocator, kv_index->entries);
+    }
+
+    *kv_index = (Kv_Index){NULL, 0, 0};
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    FNV-1a of key characters
+*/
+static uint64_t hash_key(const char* const key, const size_t key_length)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < key_length; ++i)
+    {
+        hash = (hash ^ (uint8_t)key[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static bool is_blank(const char character)
+{
+    return character == ' ' || character == '\t' || character == '\r';
+}
+
+static void trim_blanks(const char* const buffer, size_t* const begin, size_t* const end)
+{
+    while (*begin < *end && is_blank(buffer[*begin]) == true)
+    {
+        ++*begin;
+    }
+
+    while (*end > *begin && is_blank(buffer[*end - 1]) == true)
+    {
+        --*end;
+    }
+}
+
+/*
+    Table is doubled and keys are placed again, their hashes are kept in entries
+*/
+static bool kv_index_grow(Kv_Index* const kv_index, const File_Reader_Allocator* const allocator)
+{
+    const size_t new_capacity = kv_index->capacity > 0 ? kv_index->capacity * 2 : KV_INDEX_MIN_CAPACITY;
+    Kv_Index_Entry* const new_entries = allocator_allocate_zeroed(allocator, new_capacity * sizeof(*new_entries));
+
+    if (new_entries == NULL)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < kv_index->capacity; ++i)
+    {
+        const Kv_Index_Entry* const entry = &kv_index->entries[i];
+
+        if (entry->key_length > 0)
+        {
+            size_t slot = (size_t)entry->hash & (new_capacity - 1);
+
+            while (new_entries[slot].key_length > 0)
+            {
+                slot = (slot + 1) & (new_capacity - 1);
+            }
+
+            new_entries[slot] = *entry;
+        }
+    }
+
+    if (kv_index->entries != NULL)
+    {
+        allocator_deallocate(allocator, kv_index->entries);
+    }
+
+    kv_index->entries = new_entries;
+    kv_index->capacity = new_capacity;
+
+    return true;
+}
+
+/*
+    Returns entry of key or the empty slot where it belongs, table always has an empty slot
+*/
+static Kv_Index_Entry* kv_index_find_slot(const Kv_Index* const kv_index, const char* const buffer,
+                                          const uint64_t hash, const char* const key, const size_t key_length)
+{
+    size_t slot = (size_t)hash & (kv_index->capacity - 1);
+
+    while (true)
+    {
+        Kv_Index_Entry* const entry = &kv_index->entries[slot];
+
+        if (entry->key_length == 0
+            || (entry->hash == hash && entry->key_length == key_length
+                && memcmp(buffer + entry->key_offset, key, key_length) == 0))
+        {
+            return entry;
+        }
+
+        slot = (slot + 1) & (kv_index->capacity - 1);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef FILE_READER_KV_INDEX_H
+#define FILE_READER_KV_INDEX_H
+
+#include <file_reader.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Internal index of "key<separator>value" lines, e.g. /proc/meminfo, /proc/<pid>/status.
+    Keys and values are offsets in the buffer of reader, nothing is copied.
+*/
+
+typedef struct Kv_Index_Entry
+{
+    uint64_t hash;          // hash of key
+    size_t   key_offset;
+    size_t   key_length;    // 0 means empty slot, lines with empty key are not indexed
+    size_t   value_offset;
+    size_t   value_length;
+} Kv_Index_Entry;
+
+typedef struct Kv_Index
+{
+    Kv_Index_Entry* entries;     // open addressing table with linear probing
+    size_t          capacity;    // power of 2, kept at most half full, 0 if nothing is allocated
+    size_t          no_of_keys;
+} Kv_Index;
+
+/*
+    Index every line of buffer which has the separator, key and value are trimmed of blanks.
+    The first line with a key wins, later ones with the same key are skipped. Table is reused
+    and enlarged through the allocator, it has to be released by kv_index_release also on failure.
+*/
+bool kv_index_build(Kv_Index* kv_index, const char* buffer, size_t size, char separator,
+                    const File_Reader_Allocator* allocator);
+
+// value view points to the buffer which was indexed
+bool kv_index_find(const Kv_Index* kv_index, const char* buffer, const char* key, size_t key_length,
+                   File_Reader_Line_View* value);
+
+// forget keys of previous content, memory of table is kept for the next one
+void kv_index_clear(Kv_Index* kv_index);
+
+void kv_index_release(Kv_Index* kv_index, const File_Reader_Allocator* allocator);
+
+#endif // FILE_READER_KV_INDEX_H
@@ -0,0 +1,892 @@
+#define _DEFAULT_SOURCE // _SC_NPROCESSORS_ONLN
+
+#include "file_reader_line_index.h"
+#include "file_reader_allocator.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINE_INDEX_HAS_X86_SCANNERS 1
+#include <immintrin.h>
+#else
+#define LINE_INDEX_HAS_X86_SCANNERS 0
+#endif
+
+// initial capacity of offsets array is guessed from the buffer size assuming such average line length
+#define LINE_INDEX_EXPECTED_LINE_LENGTH 64
+
+// parallel indexing never gives a thread less than that
+#define LINE_INDEX_MIN_CHUNK_IN_BYTES (1024 * 1024)
+#define LINE_INDEX_MAX_NO_OF_THREADS 256
+
+// incremental indexing scans the buffer in such steps
+#define LINE_INDEX_INCREMENTAL_STEP_IN_BYTES (64 * 1024)
+
+typedef struct Line_Offset_Builder
+{
+    size_t* offsets;   // offset of the first character after each '\n' found so far
+    size_t  count;     // number of used elements of offsets
+    size_t  capacity;  // number of allocated elements of offsets
+    const File_Reader_Allocator* allocator;  // source of memory for offsets
+} Line_Offset_Builder;
+
+typedef struct Line_Index_Chunk
+{
+    const char*         buffer;       // whole buffer, offsets are relative to its beginning
+    size_t              begin;        // first byte of buffer scanned by this chunk
+    size_t              end;          // byte after the last one scanned by this chunk
+    Line_Index_Scanner  scanner;
+    size_t              no_of_new_lines;  // result of counting phase
+    Line_Offset_Builder builder;      // part of final offsets array owned by this chunk in filling phase
+    bool                is_done;      // result of filling phase
+} Line_Index_Chunk;
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static bool line_offset_builder_grow(Line_Offset_Builder* builder, size_t extra);
+static inline bool line_offset_builder_reserve(Line_Offset_Builder* builder, size_t extra);
+static Line_Index_Scanner resolve_scanner(Line_Index_Scanner scanner);
+static bool scan_line_offsets(Line_Index_Scanner scanner, const char* buffer, size_t begin, size_t end,
+                              Line_Offset_Builder* builder);
+static size_t count_new_lines(Line_Index_Scanner scanner, const char* buffer, size_t begin, size_t end);
+static bool finish_line_index(const char* buffer, size_t buffer_size, Line_Offset_Builder* builder);
+static void* count_chunk_new_lines(void* chunk);
+static void* scan_chunk_line_offsets(void* chunk);
+static void run_chunks(Line_Index_Chunk* chunks, size_t no_of_chunks, void* (*routine)(void*));
+static bool scan_line_offsets_scalar(const char* buffer, size_t begin, size_t end, Line_Offset_Builder* builder);
+static size_t count_new_lines_scalar(const char* buffer, size_t begin, size_t end);
+static bool find_last_new_line_scalar(const char* buffer, size_t begin, size_t end,
+                                      size_t* no_of_new_lines, size_t* position);
+#if LINE_INDEX_HAS_X86_SCANNERS
+static bool scan_line_offsets_sse2(const char* buffer, size_t begin, size_t end, Line_Offset_Builder* builder);
+static bool scan_line_offsets_avx2(const char* buffer, size_t begin, size_t end, Line_Offset_Builder* builder);
+static size_t count_new_lines_sse2(const char* buffer, size_t begin, size_t end);
+static size_t count_new_lines_avx2(const char* buffer, size_t begin, size_t end);
+static bool find_last_new_line_sse2(const char* buffer, size_t begin, size_t end,
+                                    size_t* no_of_new_lines, size_t* position);
+static bool find_last_new_line_avx2(const char* buffer, size_t begin, size_t end,
+                                    size_t* no_of_new_lines, size_t* position);
+#endif
+
+
+/***********************************************************
+ * FILE_READER_LINE_INDEX_H FUNCTIONS DEFINITIONS
+***********************************************************/
+
+bool line_index_scanner_is_supported(const Line_Index_Scanner scanner)
+{
+    switch (scanner)
+    {
+        case LINE_INDEX_SCANNER_AUTO:
+        case LINE_INDEX_SCANNER_SCALAR:
+            return true;
+#if LINE_INDEX_HAS_X86_SCANNERS
+        case LINE_INDEX_SCANNER_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case LINE_INDEX_SCANNER_AVX2:
+            return __builtin_cpu_supports("avx2");
+#else
+        case LINE_INDEX_SCANNER_SSE2:
+        case LINE_INDEX_SCANNER_AVX2:
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool line_index_build(const char* const buffer, const size_t buffer_size, Line_Index_Scanner scanner,
+                      const File_Reader_Allocator* const allocator,
+                      size_t** const line_offset, size_t* const line_offset_capacity, size_t* const no_of_lines)
+{
+    if (buffer == NULL || line_offset == NULL || line_offset_capacity == NULL || no_of_lines == NULL)
+    {
+        return false;
+    }
+
+    // proceed empty file
+    if (buffer_size == 0)
+    {
+        *no_of_lines = 0;
+        return true;
+    }
+
+    scanner = resolve_scanner(scanner);
+    if (line_index_scanner_is_supported(scanner) == false)
+    {
+        return false;
+    }
+
+    Line_Offset_Builder builder = {*line_offset, 0, *line_offset_capacity, allocator};
+
+    // first line always starts at the beginning of the buffer, +1 for the end marker
+    bool is_built = line_offset_builder_reserve(&builder, buffer_size / LINE_INDEX_EXPECTED_LINE_LENGTH + 2);
+
+    if (is_built == true)
+    {
+        builder.offsets[builder.count++] = 0;
+
+        // the last element of buffer is '\0' which is not a part of file content
+        is_built = scan_line_offsets(scanner, buffer, 0, buffer_size - 1, &builder)
+                   && finish_line_index(buffer, buffer_size, &builder);
+    }
+
+    // array may be reallocated, also when building failed
+    *line_offset = builder.offsets;
+    *line_offset_capacity = builder.capacity;
+
+    if (is_built == true)
+    {
+        *no_of_lines = builder.count - 1;
+    }
+
+    return is_built;
+}
+
+/*
+    Buffer is split into chunks, one per thread. Threads count '\n' of their chunks,
+    prefix sum of these counts gives the position of each chunk in the offsets array,
+    then threads fill their parts of the array. The result is the same as of line_index_build.
+*/
+bool line_index_build_parallel(const char* const buffer, const size_t buffer_size, Line_Index_Scanner scanner,
+                               size_t no_of_threads, const File_Reader_Allocator* const allocator,
+                               size_t** const line_offset, size_t* const line_offset_capacity,
+                               size_t* const no_of_lines)
+{
+    if (buffer == NULL || line_offset == NULL || line_offset_capacity == NULL || no_of_lines == NULL)
+    {
+        return false;
+    }
+
+    if (no_of_threads == 0)
+    {
+        const long no_of_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        no_of_threads = no_of_cpus > 0 ? (size_t)no_of_cpus : 1;
+    }
+
+    const size_t file_size = buffer_size > 0 ? buffer_size - 1 : 0;
+    const size_t max_no_of_chunks = file_size / LINE_INDEX_MIN_CHUNK_IN_BYTES;
+    const size_t no_of_chunks = no_of_threads < max_no_of_chunks ? no_of_threads : max_no_of_chunks;
+
+    if (no_of_chunks <= 1)
+    {
+        return line_index_build(buffer, buffer_size, scanner, allocator,
+                                line_offset, line_offset_capacity, no_of_lines);
+    }
+
+    scanner = resolve_scanner(scanner);
+    if (line_index_scanner_is_supported(scanner) == false)
+    {
+        return false;
+    }
+
+    Line_Index_Chunk chunks[LINE_INDEX_MAX_NO_OF_THREADS];
+    const size_t used_chunks = no_of_chunks < LINE_INDEX_MAX_NO_OF_THREADS ? no_of_chunks : LINE_INDEX_MAX_NO_OF_THREADS;
+    const size_t chunk_size = file_size / used_chunks;
+
+    for (size_t i = 0; i < used_chunks; ++i)
+    {
+        chunks[i] = (Line_Index_Chunk){0};
+        chunks[i].buffer = buffer;
+        chunks[i].begin = i * chunk_size;
+        chunks[i].end = (i == used_chunks - 1) ? file_size : (i + 1) * chunk_size;
+        chunks[i].scanner = scanner;
+    }
+
+    run_chunks(chunks, used_chunks, count_chunk_new_lines);
+
+    size_t total_no_of_new_lines = 0;
+    for (size_t i = 0; i < used_chunks; ++i)
+    {
+        total_no_of_new_lines += chunks[i].no_of_new_lines;
+    }
+
+    // first offset is 0 and the last one may be the end marker
+    Line_Offset_Builder builder = {*line_offset, 0, *line_offset_capacity, allocator};
+    bool is_built = line_offset_builder_reserve(&builder, total_no_of_new_lines + 2);
+
+    // array may be reallocated, also when building fails
+    *line_offset = builder.offsets;
+    *line_offset_capacity = builder.capacity;
+
+    if (is_built == false)
+    {
+        return false;
+    }
+
+    builder.offsets[builder.count++] = 0;
+
+    // prefix sum, every chunk gets a builder with exact capacity so it never reallocates
+    for (size_t i = 0; i < used_chunks; ++i)
+    {
+        chunks[i].builder.offsets = builder.offsets + builder.count;
+        chunks[i].builder.capacity = chunks[i].no_of_new_lines;
+        builder.count += chunks[i].no_of_new_lines;
+    }
+
+    run_chunks(chunks, used_chunks, scan_chunk_line_offsets);
+
+    for (size_t i = 0; i < used_chunks; ++i)
+    {
+        if (chunks[i].is_done == false || chunks[i].builder.count != chunks[i].no_of_new_lines)
+        {
+            return false;
+        }
+    }
+
+    // end marker fits in the reserved space
+    is_built = finish_line_index(buffer, buffer_size, &builder);
+    *no_of_lines = builder.count - 1;
+
+    return is_built;
+}
+
+bool line_index_build_until(const char* const buffer, const size_t buffer_size, Line_Index_Scanner scanner,
+                            const File_Reader_Allocator* const allocator, const size_t offset_index,
+                            size_t** const line_offset, size_t* const line_offset_capacity,
+                            size_t* const no_of_offsets, size_t* const scanned_size,
+                            size_t* const no_of_lines, bool* const is_complete)
+{
+    if (buffer == NULL || line_offset == NULL || line_offset_capacity == NULL || no_of_offsets == NULL
+        || scanned_size == NULL || no_of_lines == NULL || is_complete == NULL)
+    {
+        return false;
+    }
+
+    *is_complete = false;
+
+    // proceed empty file
+    if (buffer_size == 0)
+    {
+        *no_of_lines = 0;
+        *is_complete = true;
+        return true;
+    }
+
+    scanner = resolve_scanner(scanner);
+    if (line_index_scanner_is_supported(scanner) == false)
+    {
+        return false;
+    }
+
+    Line_Offset_Builder builder = {*line_offset, *no_of_offsets, *line_offset_capacity, allocator};
+    const size_t file_size = buffer_size - 1;
+    size_t position = *scanned_size;
+    bool is_scanned = true;
+
+    // first line always starts at the beginning of the buffer
+    if (builder.count == 0)
+    {
+        is_scanned = line_offset_builder_reserve(&builder,
+                                                 LINE_INDEX_INCREMENTAL_STEP_IN_BYTES / LINE_INDEX_EXPECTED_LINE_LENGTH + 2);
+        if (is_scanned == true)
+        {
+            builder.offsets[builder.count++] = 0;
+        }
+    }
+
+    while (is_scanned == true && builder.count <= offset_index && position < file_size)
+    {
+        const size_t step_end = file_size - position > LINE_INDEX_INCREMENTAL_STEP_IN_BYTES ?
+            position + LINE_INDEX_INCREMENTAL_STEP_IN_BYTES : file_size;
+
+        is_scanned = scan_line_offsets(scanner, buffer, position, step_end, &builder);
+        if (is_scanned == true)
+        {
+            // step is taken into account only when it is scanned completely
+            position = step_end;
+            *no_of_offsets = builder.count;
+            *scanned_size = position;
+        }
+    }
+
+    bool is_built = is_scanned;
+
+    if (is_scanned == true && position == file_size)
+    {
+        is_built = finish_line_index(buffer, buffer_size, &builder);
+        if (is_built == true)
+        {
+            *no_of_offsets = builder.count;
+            *no_of_lines = builder.count - 1;
+            *is_complete = true;
+        }
+    }
+
+    // array may be reallocated, also when building failed
+    *line_offset = builder.offsets;
+    *line_offset_capacity = builder.capacity;
+
+    return is_built;
+}
+
+bool line_index_find_last_new_line(const char* const buffer, const size_t begin, const size_t end,
+                                   const Line_Index_Scanner scanner, size_t* const no_of_new_lines,
+                                   size_t* const position)
+{
+    if (buffer == NULL || no_of_new_lines == NULL || position == NULL || *no_of_new_lines == 0 || begin >= end)
+    {
+        return false;
+    }
+
+    switch (resolve_scanner(scanner))
+    {
+#if LINE_INDEX_HAS_X86_SCANNERS
+        case LINE_INDEX_SCANNER_SSE2:
+            return find_last_new_line_sse2(buffer, begin, end, no_of_new_lines, position);
+        case LINE_INDEX_SCANNER_AVX2:
+            return find_last_new_line_avx2(buffer, begin, end, no_of_new_lines, position);
+#endif
+        case LINE_INDEX_SCANNER_AUTO:
+        case LINE_INDEX_SCANNER_SCALAR:
+        default:
+            return find_last_new_line_scalar(buffer, begin, end, no_of_new_lines, position);
+    }
+}
+
+bool line_index_compact(const File_Reader_Allocator* const allocator, const size_t no_of_lines,
+                        const bool allow_narrow, size_t** const line_offset, size_t* const line_offset_capacity,
+                        size_t** const line_base, size_t* const line_base_capacity, Line_Index_Format* const format)
+{
+    if (line_offset == NULL || line_offset_capacity == NULL || line_base == NULL || line_base_capacity == NULL
+        || format == NULL || *format != LINE_INDEX_FORMAT_WIDE)
+    {
+        return false;
+    }
+
+    // nothing to compact, e.g. empty file
+    if (*line_offset == NULL)
+    {
+        return true;
+    }
+
+    size_t* const offsets = *line_offset;
+    const size_t no_of_offsets = no_of_lines + 1;
+
+    // offsets are ascending, so the last one is the biggest
+    if (allow_narrow == true && offsets[no_of_offsets - 1] <= UINT32_MAX)
+    {
+        *format = LINE_INDEX_FORMAT_NARROW;
+    }
+    else
+    {
+        // every offset has to fit in 32 bits after subtracting base of its block
+        for (size_t i = 0; i < no_of_offsets; i += LINE_INDEX_DELTA_BLOCK_LINES)
+        {
+            const size_t last_of_block = i + LINE_INDEX_DELTA_BLOCK_LINES - 1 < no_of_offsets ?
+                i + LINE_INDEX_DELTA_BLOCK_LINES - 1 : no_of_offsets - 1;
+
+            if (offsets[last_of_block] - offsets[i] > UINT32_MAX)
+            {
+                return true;
+            }
+        }
+
+        const size_t no_of_bases = (no_of_offsets + LINE_INDEX_DELTA_BLOCK_LINES - 1) / LINE_INDEX_DELTA_BLOCK_LINES;
+
+        if (no_of_bases > *line_base_capacity)
+        {
+            size_t* const bases = allocator_reallocate(allocator, *line_base,
+                                                       *line_base_capacity * sizeof(*bases),
+                                                       no_of_bases * sizeof(*bases));
+            if (bases == NULL)
+            {
+                return false;
+            }
+
+            *line_base = bases;
+            *line_base_capacity = no_of_bases;
+        }
+
+        *format = LINE_INDEX_FORMAT_DELTA;
+    }
+
+    /*
+        uint32_t element i takes bytes which belonged to size_t element i / 2,
+        that element has been already read, so the array can be converted in place.
+        Elements are written by memcpy, so these writes can't be reordered with reads of offsets.
+    */
+    unsigned char* const compact_offsets = (unsigned char*)offsets;
+    size_t base = 0;
+
+    for (size_t i = 0; i < no_of_offsets; ++i)
+    {
+        const size_t offset = offsets[i];
+
+        if (*format == LINE_INDEX_FORMAT_DELTA && i % LINE_INDEX_DELTA_BLOCK_LINES == 0)
+        {
+            base = offset;
+            (*line_base)[i / LINE_INDEX_DELTA_BLOCK_LINES] = base;
+        }
+
+        const uint32_t compact_offset = (uint32_t)(offset - base);
+        memcpy(compact_offsets + i * sizeof(compact_offset), &compact_offset, sizeof(compact_offset));
+    }
+
+    // give back the second half of array, if it is not possible array just stays bigger
+    const size_t compact_capacity = (no_of_offsets * sizeof(uint32_t) + sizeof(size_t) - 1) / sizeof(size_t);
+
+    if (compact_capacity < *line_offset_capacity)
+    {
+        size_t* const shrunk_offsets = allocator_reallocate(allocator, offsets,
+                                                            *line_offset_capacity * sizeof(*offsets),
+                                                            compact_capacity * sizeof(*offsets));
+        if (shrunk_offsets != NULL)
+        {
+            *line_offset = shrunk_offsets;
+            *line_offset_capacity = compact_capacity;
+        }
+    }
+
+    return true;
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+static Line_Index_Scanner resolve_scanner(const Line_Index_Scanner scanner)
+{
+    if (scanner != LINE_INDEX_SCANNER_AUTO)
+    {
+        return scanner;
+    }
+
+    if (line_index_scanner_is_supported(LINE_INDEX_SCANNER_AVX2))
+    {
+        return LINE_INDEX_SCANNER_AVX2;
+    }
+
+    if (line_index_scanner_is_supported(LINE_INDEX_SCANNER_SSE2))
+    {
+        return LINE_INDEX_SCANNER_SSE2;
+    }
+
+    return LINE_INDEX_SCANNER_SCALAR;
+}
+
+static bool scan_line_offsets(const Line_Index_Scanner scanner, const char* const buffer,
+                              const size_t begin, const size_t end, Line_Offset_Builder* const builder)
+{
+    switch (scanner)
+    {
+#if LINE_INDEX_HAS_X86_SCANNERS
+        case LINE_INDEX_SCANNER_SSE2:
+            return scan_line_offsets_sse2(buffer, begin, end, builder);
+        case LINE_INDEX_SCANNER_AVX2:
+            return scan_line_offsets_avx2(buffer, begin, end, builder);
+#endif
+        case LINE_INDEX_SCANNER_AUTO:
+        case LINE_INDEX_SCANNER_SCALAR:
+        default:
+            return scan_line_offsets_scalar(buffer, begin, end, builder);
+    }
+}
+
+static size_t count_new_lines(const Line_Index_Scanner scanner, const char* const buffer,
+                              const size_t begin, const size_t end)
+{
+    switch (scanner)
+    {
+#if LINE_INDEX_HAS_X86_SCANNERS
+        case LINE_INDEX_SCANNER_SSE2:
+            return count_new_lines_sse2(buffer, begin, end);
+        case LINE_INDEX_SCANNER_AVX2:
+            return count_new_lines_avx2(buffer, begin, end);
+#endif
+        case LINE_INDEX_SCANNER_AUTO:
+        case LINE_INDEX_SCANNER_SCALAR:
+        default:
+            return count_new_lines_scalar(buffer, begin, end);
+    }
+}
+
+/*
+    Every '\n' starts a new line, except the '\n' which is the last character of file.
+    In that case its offset is already the end marker, otherwise add the marker
+    right after the '\0' which terminates the last line.
+*/
+static bool finish_line_index(const char* const buffer, const size_t buffer_size, Line_Offset_Builder* const builder)
+{
+    const size_t file_size = buffer_size - 1;
+    const bool has_trailing_new_line = file_size > 0 && buffer[file_size - 1] == '\n';
+
+    if (has_trailing_new_line == false)
+    {
+        if (line_offset_builder_reserve(builder, 1) == false)
+        {
+            return false;
+        }
+        builder->offsets[builder->count++] = buffer_size;
+    }
+
+    return true;
+}
+
+static void* count_chunk_new_lines(void* const chunk)
+{
+    Line_Index_Chunk* const index_chunk = chunk;
+    index_chunk->no_of_new_lines =
+        count_new_lines(index_chunk->scanner, index_chunk->buffer, index_chunk->begin, index_chunk->end);
+
+    return NULL;
+}
+
+static void* scan_chunk_line_offsets(void* const chunk)
+{
+    Line_Index_Chunk* const index_chunk = chunk;
+    index_chunk->is_done = scan_line_offsets(index_chunk->scanner, index_chunk->buffer,
+                                             index_chunk->begin, index_chunk->end, &index_chunk->builder);
+
+    return NULL;
+}
+
+/*
+    Run routine for every chunk, the first chunk and chunks which did not get a thread
+    are processed by the calling thread
+*/
+static void run_chunks(Line_Index_Chunk* const chunks, const size_t no_of_chunks, void* (*const routine)(void*))
+{
+    pthread_t threads[LINE_INDEX_MAX_NO_OF_THREADS];
+    bool is_thread_created[LINE_INDEX_MAX_NO_OF_THREADS] = {false};
+
+    for (size_t i = 1; i < no_of_chunks; ++i)
+    {
+        is_thread_created[i] = pthread_create(&threads[i], NULL, routine, &chunks[i]) == 0;
+    }
+
+    routine(&chunks[0]);
+
+    for (size_t i = 1; i < no_of_chunks; ++i)
+    {
+        if (is_thread_created[i] == true)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            routine(&chunks[i]);
+        }
+    }
+}
+
+static bool line_offset_builder_grow(Line_Offset_Builder* const builder, const size_t extra)
+{
+    size_t new_capacity = builder->capacity > 0 ? builder->capacity : 1;
+
+    while (new_capacity < builder->count + extra)
+    {
+        new_capacity = new_capacity * 2;
+    }
+
+    size_t* const new_offsets = allocator_reallocate(builder->allocator,
+                                                     builder->offsets,
+                                                     builder->capacity * sizeof(*new_offsets),
+                                                     new_capacity * sizeof(*new_offsets));
+    if (new_offsets == NULL)
+    {
+        return false;
+    }
+
+    builder->offsets = new_offsets;
+    builder->capacity = new_capacity;
+
+    return true;
+}
+
+static inline bool line_offset_builder_reserve(Line_Offset_Builder* const builder, const size_t extra)
+{
+    if (builder->count + extra <= builder->capacity)
+    {
+        return true;
+    }
+
+    return line_offset_builder_grow(builder, extra);
+}
+
+/*
+    Portable scanner, memchr of the C library is usually vectorized on its own
+*/
+static bool scan_line_offsets_scalar(const char* const buffer, const size_t begin, const size_t end,
+                                     Line_Offset_Builder* const builder)
+{
+    const char* position = buffer + begin;
+    const char* const end_position = buffer + end;
+
+    while (position < end_position)
+    {
+        const char* const new_line = memchr(position, '\n', (size_t)(end_position - position));
+        if (new_line == NULL)
+        {
+            break;
+        }
+
+        if (line_offset_builder_reserve(builder, 1) == false)
+        {
+            return false;
+        }
+
+        position = new_line + 1;
+        builder->offsets[builder->count++] = (size_t)(position - buffer);
+    }
+
+    return true;
+}
+
+static size_t count_new_lines_scalar(const char* const buffer, const size_t begin, const size_t end)
+{
+    size_t no_of_new_lines = 0;
+
+    for (size_t position = begin; position < end; ++position)
+    {
+        no_of_new_lines += (buffer[position] == '\n');
+    }
+
+    return no_of_new_lines;
+}
+
+static bool find_last_new_line_scalar(const char* const buffer, const size_t begin, size_t end,
+                                      size_t* const no_of_new_lines, size_t* const position)
+{
+    while (end > begin)
+    {
+        --end;
+
+        if (buffer[end] == '\n' && --*no_of_new_lines == 0)
+        {
+            *position = end;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#if LINE_INDEX_HAS_X86_SCANNERS
+
+/*
+    Store offsets of characters after '\n' marked by bits of mask, block_begin is offset of bit 0
+*/
+static inline bool push_line_offsets_from_mask(uint64_t mask, const size_t block_begin,
+                                               Line_Offset_Builder* const builder)
+{
+    if (line_offset_builder_reserve(builder, (size_t)__builtin_popcountll(mask)) == false)
+    {
+        return false;
+    }
+
+    size_t* const offsets = builder->offsets;
+    size_t count = builder->count;
+
+    while (mask != 0)
+    {
+        offsets[count++] = block_begin + (size_t)__builtin_ctzll(mask) + 1;
+        mask &= mask - 1;
+    }
+
+    builder->count = count;
+
+    return true;
+}
+
+__attribute__((target("sse2")))
+static bool scan_line_offsets_sse2(const char* const buffer, const size_t begin, const size_t end,
+                                   Line_Offset_Builder* const builder)
+{
+    enum {BLOCK_SIZE = 64};
+    const __m128i new_line = _mm_set1_epi8('\n');
+    size_t position = begin;
+
+    for (; position + BLOCK_SIZE <= end; position += BLOCK_SIZE)
+    {
+        const char* const block = buffer + position;
+        const __m128i chunk_0 = _mm_loadu_si128((const __m128i*)(const void*)(block));
+        const __m128i chunk_1 = _mm_loadu_si128((const __m128i*)(const void*)(block + 16));
+        const __m128i chunk_2 = _mm_loadu_si128((const __m128i*)(const void*)(block + 32));
+        const __m128i chunk_3 = _mm_loadu_si128((const __m128i*)(const void*)(block + 48));
+
+        const uint64_t mask =
+              (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_0, new_line))
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_1, new_line)) << 16
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_2, new_line)) << 32
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_3, new_line)) << 48;
+
+        if (mask != 0 && push_line_offsets_from_mask(mask, position, builder) == false)
+        {
+            return false;
+        }
+    }
+
+    // the tail which does not fill whole block
+    return scan_line_offsets_scalar(buffer, position, end, builder);
+}
+
+__attribute__((target("avx2")))
+static bool scan_line_offsets_avx2(const char* const buffer, const size_t begin, const size_t end,
+                                   Line_Offset_Builder* const builder)
+{
+    enum {BLOCK_SIZE = 64};
+    const __m256i new_line = _mm256_set1_epi8('\n');
+    size_t position = begin;
+
+    for (; position + BLOCK_SIZE <= end; position += BLOCK_SIZE)
+    {
+        const char* const block = buffer + position;
+        const __m256i chunk_0 = _mm256_loadu_si256((const __m256i*)(const void*)(block));
+        const __m256i chunk_1 = _mm256_loadu_si256((const __m256i*)(const void*)(block + 32));
+
+        const uint64_t mask =
+              (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_0, new_line))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_1, new_line)) << 32;
+
+        if (mask != 0 && push_line_offsets_from_mask(mask, position, builder) == false)
+        {
+            return false;
+        }
+    }
+
+    // the tail which does not fill whole block
+    return scan_line_offsets_scalar(buffer, position, end, builder);
+}
+
+__attribute__((target("sse2")))
+static size_t count_new_lines_sse2(const char* const buffer, const size_t begin, const size_t end)
+{
+    enum {BLOCK_SIZE = 64};
+    const __m128i new_line = _mm_set1_epi8('\n');
+    size_t no_of_new_lines = 0;
+    size_t position = begin;
+
+    for (; position + BLOCK_SIZE <= end; position += BLOCK_SIZE)
+    {
+        const char* const block = buffer + position;
+        const __m128i chunk_0 = _mm_loadu_si128((const __m128i*)(const void*)(block));
+        const __m128i chunk_1 = _mm_loadu_si128((const __m128i*)(const void*)(block + 16));
+        const __m128i chunk_2 = _mm_loadu_si128((const __m128i*)(const void*)(block + 32));
+        const __m128i chunk_3 = _mm_loadu_si128((const __m128i*)(const void*)(block + 48));
+
+        const uint64_t mask =
+              (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_0, new_line))
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_1, new_line)) << 16
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_2, new_line)) << 32
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_3, new_line)) << 48;
+
+        no_of_new_lines += (size_t)__builtin_popcountll(mask);
+    }
+
+    return no_of_new_lines + count_new_lines_scalar(buffer, position, end);
+}
+
+__attribute__((target("avx2")))
+static size_t count_new_lines_avx2(const char* const buffer, const size_t begin, const size_t end)
+{
+    enum {BLOCK_SIZE = 64};
+    const __m256i new_line = _mm256_set1_epi8('\n');
+    size_t no_of_new_lines = 0;
+    size_t position = begin;
+
+    for (; position + BLOCK_SIZE <= end; position += BLOCK_SIZE)
+    {
+        const char* const block = buffer + position;
+        const __m256i chunk_0 = _mm256_loadu_si256((const __m256i*)(const void*)(block));
+        const __m256i chunk_1 = _mm256_loadu_si256((const __m256i*)(const void*)(block + 32));
+
+        const uint64_t mask =
+              (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_0, new_line))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_1, new_line)) << 32;
+
+        no_of_new_lines += (size_t)__builtin_popcountll(mask);
+    }
+
+    return no_of_new_lines + count_new_lines_scalar(buffer, position, end);
+}
+
+/*
+    Bits of mask are '\n' of 64 bytes block, they are taken from the highest one (the last '\n')
+*/
+static inline bool find_last_new_line_in_mask(uint64_t mask, const size_t block_begin,
+                                              size_t* const no_of_new_lines, size_t* const position)
+{
+    const size_t no_of_block_new_lines = (size_t)__builtin_popcountll(mask);
+
+    if (no_of_block_new_lines < *no_of_new_lines)
+    {
+        *no_of_new_lines -= no_of_block_new_lines;
+        return false;
+    }
+
+    for (size_t i = 1; i < *no_of_new_lines; ++i)
+    {
+        mask &= ~((uint64_t)1 << (63 - __builtin_clzll(mask)));
+    }
+
+    *no_of_new_lines = 0;
+    *position = block_begin + (size_t)(63 - __builtin_clzll(mask));
+
+    return true;
+}
+
+__attribute__((target("sse2")))
+static bool find_last_new_line_sse2(const char* const buffer, const size_t begin, const size_t end,
+                                    size_t* const no_of_new_lines, size_t* const position)
+{
+    enum {BLOCK_SIZE = 64};
+    const __m128i new_line = _mm_set1_epi8('\n');
+    size_t block_end = end;
+
+    for (; block_end >= begin + BLOCK_SIZE; block_end -= BLOCK_SIZE)
+    {
+        const char* const block = buffer + block_end - BLOCK_SIZE;
+        const __m128i chunk_0 = _mm_loadu_si128((const __m128i*)(const void*)(block));
+        const __m128i chunk_1 = _mm_loadu_si128((const __m128i*)(const void*)(block + 16));
+        const __m128i chunk_2 = _mm_loadu_si128((const __m128i*)(const void*)(block + 32));
+        const __m128i chunk_3 = _mm_loadu_si128((const __m128i*)(const void*)(block + 48));
+
+        const uint64_t mask =
+              (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_0, new_line))
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_1, new_line)) << 16
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_2, new_line)) << 32
+            | (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk_3, new_line)) << 48;
+
+        if (mask != 0 && find_last_new_line_in_mask(mask, block_end - BLOCK_SIZE, no_of_new_lines, position) == true)
+        {
+            return true;
+        }
+    }
+
+    return find_last_new_line_scalar(buffer, begin, block_end, no_of_new_lines, position);
+}
+
+__attribute__((target("avx2")))
+static bool find_last_new_line_avx2(const char* const buffer, const size_t begin, const size_t end,
+                                    size_t* const no_of_new_lines, size_t* const position)
+{
+    enum {BLOCK_SIZE = 64};
+    const __m256i new_line = _mm256_set1_epi8('\n');
+    size_t block_end = end;
+
+    for (; block_end >= begin + BLOCK_SIZE; block_end -= BLOCK_SIZE)
+    {
+        const char* const block = buffer + block_end - BLOCK_SIZE;
+        const __m256i chunk_0 = _mm256_loadu_si256((const __m256i*)(const void*)(block));
+        const __m256i chunk_1 = _mm256_loadu_si256((const __m256i*)(const void*)(block + 32));
+
+        const uint64_t mask =
+              (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_0, new_line))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk_1, new_line)) << 32;
+
+        if (mask != 0 && find_last_new_line_in_mask(mask, block_end - BLOCK_SIZE, no_of_new_lines, position) == true)
+        {
+            return true;
+        }
+    }
+
+    return find_last_new_line_scalar(buffer, begin, block_end, no_of_new_lines, position);
+}
+
+#endif // LINE_INDEX_HAS_X86_SCANNERS
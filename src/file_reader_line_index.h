@@ -0,0 +1,122 @@
+#ifndef FILE_READER_LINE_INDEX_H
+#define FILE_READER_LINE_INDEX_H
+
+#include <file_reader.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Internal interface of the line indexer, shared by the reader and the benchmarks.
+*/
+
+typedef enum Line_Index_Scanner
+{
+    LINE_INDEX_SCANNER_AUTO,    // pick the fastest scanner supported by the CPU
+    LINE_INDEX_SCANNER_SCALAR,  // portable memchr based scanner
+    LINE_INDEX_SCANNER_SSE2,
+    LINE_INDEX_SCANNER_AVX2
+} Line_Index_Scanner;
+
+typedef enum Line_Index_Format
+{
+    LINE_INDEX_FORMAT_WIDE,    // size_t offset per line
+    LINE_INDEX_FORMAT_NARROW,  // uint32_t offset per line, buffer not bigger than 4 GB
+    LINE_INDEX_FORMAT_DELTA    // uint32_t offset per line relative to the base of its block
+} Line_Index_Format;
+
+// number of lines which share one base in delta format
+#define LINE_INDEX_DELTA_BLOCK_LINES 64
+
+bool line_index_scanner_is_supported(Line_Index_Scanner scanner);
+
+/*
+    Count lines and fill offsets of buffer (file content extended by '\0') in a single pass.
+    *line_offset is NULL or an array of *line_offset_capacity elements which is reused,
+    it is enlarged through the allocator (NULL means realloc) when needed. The array is always
+    owned by the caller, also when the function fails, and has to be released through the allocator.
+    On success *line_offset has no_of_lines + 1 used elements,
+    line_offset[no_of_lines] marks the position right after the last line terminator.
+*/
+bool line_index_build(const char* buffer, size_t buffer_size, Line_Index_Scanner scanner,
+                      const File_Reader_Allocator* allocator,
+                      size_t** line_offset, size_t* line_offset_capacity, size_t* no_of_lines);
+
+/*
+    Same as line_index_build but the buffer is split among no_of_threads threads
+    (0 means number of online CPUs). Small buffers are indexed by the calling thread.
+*/
+bool line_index_build_parallel(const char* buffer, size_t buffer_size, Line_Index_Scanner scanner,
+                               size_t no_of_threads, const File_Reader_Allocator* allocator,
+                               size_t** line_offset, size_t* line_offset_capacity, size_t* no_of_lines);
+
+/*
+    Incremental variant of line_index_build. First *no_of_offsets elements of *line_offset
+    are already built from the first *scanned_size bytes of buffer (both 0 at the beginning).
+    Buffer is scanned further in steps until line_offset[offset_index] is known or the whole
+    buffer is scanned. In the latter case the index is finished as by line_index_build,
+    *no_of_lines is set and *is_complete becomes true.
+*/
+bool line_index_build_until(const char* buffer, size_t buffer_size, Line_Index_Scanner scanner,
+                            const File_Reader_Allocator* allocator, size_t offset_index,
+                            size_t** line_offset, size_t* line_offset_capacity, size_t* no_of_offsets,
+                            size_t* scanned_size, size_t* no_of_lines, bool* is_complete);
+
+/*
+    Scan buffer[begin, end) backwards for the *no_of_new_lines-th '\n' counted from end.
+    Returns true and its offset in *position if it is there, otherwise *no_of_new_lines
+    is decreased by number of '\n' in the range, so the search continues in the preceding range.
+*/
+bool line_index_find_last_new_line(const char* buffer, size_t begin, size_t end, Line_Index_Scanner scanner,
+                                   size_t* no_of_new_lines, size_t* position);
+
+/*
+    Convert wide index built by line_index_build to narrow or delta format in place,
+    the array is shrunk afterwards. Delta format needs bases, one for every LINE_INDEX_DELTA_BLOCK_LINES
+    lines, which are stored in *line_base (reused array of *line_base_capacity elements).
+    Narrow format is used when it fits and is allowed, if neither of them fits index stays wide.
+*/
+bool line_index_compact(const File_Reader_Allocator* allocator, size_t no_of_lines, bool allow_narrow,
+                        size_t** line_offset, size_t* line_offset_capacity,
+                        size_t** line_base, size_t* line_base_capacity, Line_Index_Format* format);
+
+/*
+    Line index file keeps offsets of a complete wide index next to the source file, it is valid
+    as long as the source file has the same size and modification time.
+*/
+typedef struct Line_Index_Source
+{
+    uint64_t file_size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint32_t file_mode;    // permission bits of source file, index file gets the same read and write bits
+    const char* content;   // loaded content of source file, mapped offsets have to start lines of it
+} Line_Index_Source;
+
+bool line_index_file_save(const char* index_file_name, const Line_Index_Source* source,
+                          const size_t* line_offset, size_t no_of_lines);
+
+/*
+    Offsets of mapped index are read-only, they have to be released by line_index_file_unmap
+*/
+bool line_index_file_map(const char* index_file_name, const Line_Index_Source* source,
+                         size_t** line_offset, size_t* no_of_lines, size_t* mapping_size);
+void line_index_file_unmap(size_t* line_offset, size_t mapping_size);
+
+static inline size_t line_index_get_offset(const size_t* const line_offset, const size_t* const line_base,
+                                           const Line_Index_Format format, const size_t index)
+{
+    switch (format)
+    {
+        case LINE_INDEX_FORMAT_NARROW:
+            return ((const uint32_t*)(const void*)line_offset)[index];
+        case LINE_INDEX_FORMAT_DELTA:
+            return line_base[index / LINE_INDEX_DELTA_BLOCK_LINES]
+                   + ((const uint32_t*)(const void*)line_offset)[index];
+        case LINE_INDEX_FORMAT_WIDE:
+        default:
+            return line_offset[index];
+    }
+}
+
+#endif // FILE_READER_LINE_INDEX_H
@@ -0,0 +1,254 @@
+#define _DEFAULT_SOURCE // mkstemp
+
+#include "file_reader_line_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LINE_INDEX_FILE_MAGIC "FRLINDEX"
+#define LINE_INDEX_FILE_VERSION 1
+#define LINE_INDEX_FILE_TEMP_SUFFIX ".XXXXXX"
+
+/*
+    Line index file starts with this header, offsets (size_t each) follow it.
+    Header is 64 bytes long, so offsets are aligned in the mapping.
+*/
+typedef struct Line_Index_File_Header
+{
+    char     magic[8];       // LINE_INDEX_FILE_MAGIC without '\0'
+    uint32_t version;        // LINE_INDEX_FILE_VERSION
+    uint32_t offset_size;    // sizeof(size_t) of the writer, offsets are used only by the same size
+    uint64_t file_size;      // size of source file
+    int64_t  mtime_sec;      // modification time of source file
+    int64_t  mtime_nsec;
+    uint64_t no_of_lines;    // number of lines, there are no_of_lines + 1 offsets
+    uint64_t checksum;       // of the header fields above and all offsets
+    uint64_t reserved;
+} Line_Index_File_Header;
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static uint64_t calculate_checksum(const Line_Index_File_Header* header, const size_t* line_offset,
+                                   bool* are_offsets_valid);
+static bool write_to_file(int fd, const void* data, size_t size);
+
+
+/***********************************************************
+ * FILE_READER_LINE_INDEX_H LINE INDEX FILE FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Index is written to a temporary file which replaces the index file at once,
+    so readers never map a partially written index.
+*/
+bool line_index_file_save(const char* const index_file_name, const Line_Index_Source* const source,
+                          const size_t* const line_offset, const size_t no_of_lines)
+{
+    if (index_file_name == NULL || source == NULL || line_offset == NULL)
+    {
+        return false;
+    }
+
+    Line_Index_File_Header header = {{0}, LINE_INDEX_FILE_VERSION, (uint32_t)sizeof(size_t), source->file_size,
+                                     source->mtime_sec, source->mtime_nsec, (uint64_t)no_of_lines, 0, 0};
+    memcpy(header.magic, LINE_INDEX_FILE_MAGIC, sizeof(header.magic));
+    header.checksum = calculate_checksum(&header, line_offset, NULL);
+
+    const size_t temp_file_name_size = strlen(index_file_name) + sizeof(LINE_INDEX_FILE_TEMP_SUFFIX);
+    char* const temp_file_name = malloc(temp_file_name_size);
+    if (temp_file_name == NULL)
+    {
+        return false;
+    }
+
+    memcpy(temp_file_name, index_file_name, strlen(index_file_name));
+    memcpy(temp_file_name + strlen(index_file_name), LINE_INDEX_FILE_TEMP_SUFFIX, sizeof(LINE_INDEX_FILE_TEMP_SUFFIX));
+
+    const int fd = mkstemp(temp_file_name);
+    if (fd == -1)
+    {
+        //printf("Can't create line index file: \"%s\"\n", temp_file_name);
+        free(temp_file_name);
+        return false;
+    }
+
+    bool is_saved = write_to_file(fd, &header, sizeof(header))
+                    && write_to_file(fd, line_offset, (no_of_lines + 1) * sizeof(*line_offset));
+
+    // index file reveals the lines of source file, so it can be read only by those who can read the source
+    const mode_t index_file_mode = (mode_t)source->file_mode
+                                   & (S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    is_saved = is_saved && fchmod(fd, index_file_mode) == 0;
+    is_saved = close(fd) == 0 && is_saved;
+    is_saved = is_saved && rename(temp_file_name, index_file_name) == 0;
+
+    if (is_saved == false)
+    {
+        unlink(temp_file_name);
+    }
+
+    free(temp_file_name);
+
+    return is_saved;
+}
+
+/*
+    Map index file if it describes the source file as it is now, so its offsets can be used
+    without scanning the source. Returns false if there is no such file or it doesn't match.
+*/
+bool line_index_file_map(const char* const index_file_name, const Line_Index_Source* const source,
+                         size_t** const line_offset, size_t* const no_of_lines, size_t* const mapping_size)
+{
+    if (index_file_name == NULL || source == NULL || line_offset == NULL || no_of_lines == NULL || mapping_size == NULL)
+    {
+        return false;
+    }
+
+    const int fd = open(index_file_name, O_RDONLY);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat index_file_stat = {0};
+    if (fstat(fd, &index_file_stat) == -1 || (size_t)index_file_stat.st_size < sizeof(Line_Index_File_Header))
+    {
+        close(fd);
+        return false;
+    }
+
+    const size_t index_file_size = (size_t)index_file_stat.st_size;
+    void* const mapping = mmap(NULL, index_file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // mapping is independent of file descriptor, so close it now
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const Line_Index_File_Header* const header = mapping;
+    size_t* const offsets = (size_t*)(void*)((char*)mapping + sizeof(*header));
+
+    bool is_matching = memcmp(header->magic, LINE_INDEX_FILE_MAGIC, sizeof(header->magic)) == 0
+                       && header->version == LINE_INDEX_FILE_VERSION
+                       && header->offset_size == sizeof(size_t)
+                       && header->file_size == source->file_size
+                       && header->mtime_sec == source->mtime_sec
+                       && header->mtime_nsec == source->mtime_nsec
+                       && header->no_of_lines < (index_file_size - sizeof(*header)) / sizeof(size_t)
+                       && index_file_size == sizeof(*header) + (header->no_of_lines + 1) * sizeof(size_t);
+
+    // end marker is the file size or right after '\0', the checksum finds accidental damages only,
+    // so offsets which are used to read the buffer are checked as if the file was crafted
+    bool are_offsets_valid = false;
+    is_matching = is_matching
+                  && (offsets[header->no_of_lines] == source->file_size
+                      || offsets[header->no_of_lines] == source->file_size + 1)
+                  && calculate_checksum(header, offsets, &are_offsets_valid) == header->checksum
+                  && are_offsets_valid == true;
+
+    // every line but the first one starts right after '\n'
+    for (size_t i = 1; is_matching == true && i < header->no_of_lines; ++i)
+    {
+        is_matching = source->content[offsets[i] - 1] == '\n';
+    }
+
+    if (is_matching == false)
+    {
+        munmap(mapping, index_file_size);
+        return false;
+    }
+
+    *line_offset = offsets;
+    *no_of_lines = (size_t)header->no_of_lines;
+    *mapping_size = index_file_size;
+
+    return true;
+}
+
+void line_index_file_unmap(size_t* const line_offset, const size_t mapping_size)
+{
+    if (line_offset == NULL || mapping_size == 0)
+    {
+        return;
+    }
+
+    munmap((char*)line_offset - sizeof(Line_Index_File_Header), mapping_size);
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    FNV-1a over 64-bit words of the header fields and offsets. Offsets are checked on the way (if asked),
+    they have to start at 0 and increase, each line has at least one character. Only the end marker
+    may be right after '\0', starts of lines are within the file.
+*/
+static uint64_t calculate_checksum(const Line_Index_File_Header* const header, const size_t* const line_offset,
+                                   bool* const are_offsets_valid)
+{
+    const uint64_t fnv_prime = 0x100000001b3ull;
+    uint64_t checksum = 0xcbf29ce484222325ull;
+
+    const uint64_t header_fields[] = {header->version, header->offset_size, header->file_size,
+                                      (uint64_t)header->mtime_sec, (uint64_t)header->mtime_nsec, header->no_of_lines};
+
+    for (size_t i = 0; i < sizeof(header_fields) / sizeof(header_fields[0]); ++i)
+    {
+        checksum = (checksum ^ header_fields[i]) * fnv_prime;
+    }
+
+    bool is_valid = line_offset[0] == 0;
+
+    for (size_t i = 0; i <= header->no_of_lines; ++i)
+    {
+        checksum = (checksum ^ (uint64_t)line_offset[i]) * fnv_prime;
+        is_valid = is_valid && line_offset[i] <= header->file_size + (i == header->no_of_lines ? 1 : 0)
+                   && (i == 0 || line_offset[i] > line_offset[i - 1]);
+    }
+
+    if (are_offsets_valid != NULL)
+    {
+        *are_offsets_valid = is_valid;
+    }
+
+    return checksum;
+}
+
+static bool write_to_file(const int fd, const void* const data, const size_t size)
+{
+    const char* const bytes = data;
+    size_t bytes_written = 0;
+
+    while (bytes_written < size)
+    {
+        const ssize_t result = write(fd, bytes + bytes_written, size - bytes_written);
+
+        // interrupted write is just repeated
+        if (result == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+
+        bytes_written += (size_t)result;
+    }
+
+    return true;
+}
@@ -0,0 +1,367 @@
+#define _GNU_SOURCE // memmem, _SC_NPROCESSORS_ONLN
+
+#include <file_reader.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_HAS_X86_SCANNER 1
+#include <immintrin.h>
+#else
+#define SEARCH_HAS_X86_SCANNER 0
+#endif
+
+// parallel search never gives a thread less than that
+#define SEARCH_MIN_CHUNK_IN_BYTES (1024 * 1024)
+#define SEARCH_MAX_NO_OF_THREADS 256
+
+typedef struct Search
+{
+    const File_Reader* file_reader;
+    const char*        buffer;         // content of file, matches are searched in the whole file
+    size_t             file_size;
+    const char*        needle;
+    size_t             needle_length;
+} Search;
+
+typedef struct Match_Sink
+{
+    File_Reader_Match_Callback callback;  // receives matches in order of their offsets
+    void*                      context;
+    size_t                     no_of_matches;
+    bool                       is_stopped;  // callback doesn't want more matches
+} Match_Sink;
+
+typedef struct Match_Array
+{
+    File_Reader_Match* matches;
+    size_t             no_of_matches;
+    size_t             capacity;
+    size_t             max_no_of_matches;  // array is not filled over that
+    bool               is_growing;         // array is enlarged when full, it belongs to a chunk of parallel search
+    bool               has_error;          // array couldn't be enlarged
+} Match_Array;
+
+typedef struct Search_Chunk
+{
+    const Search* search;
+    size_t        begin;    // first offset where a match of this chunk may start
+    size_t        end;      // offset after the last one where a match of this chunk may start
+    Match_Array   matches;  // matches found in this chunk
+} Search_Chunk;
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static bool search_init(Search* search, const File_Reader* file_reader, const char* needle, size_t needle_length);
+static void search_range(const Search* search, size_t begin, size_t end, Match_Sink* sink);
+static void search_range_scalar(const Search* search, size_t begin, size_t end, Match_Sink* sink);
+#if SEARCH_HAS_X86_SCANNER
+static size_t search_range_avx2(const Search* search, size_t begin, size_t end, Match_Sink* sink);
+#endif
+static void report_match(const Search* search, size_t offset, Match_Sink* sink);
+static bool append_match(void* match_array, const File_Reader_Match* match);
+static void* search_chunk(void* chunk);
+
+
+/***********************************************************
+ * FILE_READER_H SEARCH API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Every occurrence of needle in the file buffer is given to the callback in order of offsets,
+    overlapping occurrences included. Match belongs to the line of its first character.
+    Returns number of matches given to the callback.
+*/
+size_t file_reader_find_each(const File_Reader* const file_reader, const char* const needle, const size_t needle_length,
+                             const File_Reader_Match_Callback callback, void* const context)
+{
+    Search search;
+    if (callback == NULL || search_init(&search, file_reader, needle, needle_length) == false)
+    {
+        return 0;
+    }
+
+    Match_Sink sink = {callback, context, 0, false};
+    search_range(&search, 0, search.file_size - needle_length + 1, &sink);
+
+    return sink.no_of_matches;
+}
+
+/*
+    Same as file_reader_find_each, but first max_no_of_matches matches are stored in the array.
+    Returns number of stored matches.
+*/
+size_t file_reader_find(const File_Reader* const file_reader, const char* const needle, const size_t needle_length,
+                        File_Reader_Match* const matches, const size_t max_no_of_matches)
+{
+    if (matches == NULL || max_no_of_matches == 0)
+    {
+        return 0;
+    }
+
+    Match_Array match_array = {matches, 0, max_no_of_matches, max_no_of_matches, false, false};
+
+    return file_reader_find_each(file_reader, needle, needle_length, append_match, &match_array);
+}
+
+/*
+    Buffer is split into chunks, one per thread (0 means number of online CPUs), matches of each chunk
+    are collected separately and joined in order, so the result is the same as of file_reader_find.
+    Small buffers are searched by the calling thread. Returns number of stored matches.
+*/
+size_t file_reader_find_parallel(const File_Reader* const file_reader, const char* const needle,
+                                 const size_t needle_length, size_t no_of_threads,
+                                 File_Reader_Match* const matches, const size_t max_no_of_matches)
+{
+    Search search;
+    if (matches == NULL || max_no_of_matches == 0
+        || search_init(&search, file_reader, needle, needle_length) == false)
+    {
+        return 0;
+    }
+
+    if (no_of_threads == 0)
+    {
+        const long no_of_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        no_of_threads = no_of_cpus > 0 ? (size_t)no_of_cpus : 1;
+    }
+
+    const size_t no_of_positions = search.file_size - needle_length + 1;
+    const size_t max_no_of_chunks = no_of_positions / SEARCH_MIN_CHUNK_IN_BYTES;
+    size_t no_of_chunks = no_of_threads < max_no_of_chunks ? no_of_threads : max_no_of_chunks;
+
+    if (no_of_chunks <= 1)
+    {
+        return file_reader_find(file_reader, needle, needle_length, matches, max_no_of_matches);
+    }
+
+    if (no_of_chunks > SEARCH_MAX_NO_OF_THREADS)
+    {
+        no_of_chunks = SEARCH_MAX_NO_OF_THREADS;
+    }
+
+    Search_Chunk chunks[SEARCH_MAX_NO_OF_THREADS];
+    pthread_t threads[SEARCH_MAX_NO_OF_THREADS];
+    bool is_thread_created[SEARCH_MAX_NO_OF_THREADS] = {false};
+    const size_t chunk_size = no_of_positions / no_of_chunks;
+
+    for (size_t i = 0; i < no_of_chunks; ++i)
+    {
+        chunks[i] = (Search_Chunk){0};
+        chunks[i].search = &search;
+        chunks[i].begin = i * chunk_size;
+        chunks[i].end = (i == no_of_chunks - 1) ? no_of_positions : (i + 1) * chunk_size;
+        chunks[i].matches.max_no_of_matches = max_no_of_matches;
+        chunks[i].matches.is_growing = true;
+    }
+
+    // the first chunk and chunks which did not get a thread are searched by the calling thread
+    for (size_t i = 1; i < no_of_chunks; ++i)
+    {
+        is_thread_created[i] = pthread_create(&threads[i], NULL, search_chunk, &chunks[i]) == 0;
+    }
+
+    search_chunk(&chunks[0]);
+
+    for (size_t i = 1; i < no_of_chunks; ++i)
+    {
+        if (is_thread_created[i] == true)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        else
+        {
+            search_chunk(&chunks[i]);
+        }
+    }
+
+    size_t no_of_matches = 0;
+    bool has_error = false;
+
+    for (size_t i = 0; i < no_of_chunks; ++i)
+    {
+        const size_t space_left = max_no_of_matches - no_of_matches;
+        const size_t to_copy = chunks[i].matches.no_of_matches < space_left ? chunks[i].matches.no_of_matches : space_left;
+
+        // matches after the one which couldn't be stored are not valid
+        if (has_error == false && to_copy > 0)
+        {
+            memcpy(matches + no_of_matches, chunks[i].matches.matches, to_copy * sizeof(*matches));
+            no_of_matches += to_copy;
+        }
+
+        has_error |= chunks[i].matches.has_error;
+        free(chunks[i].matches.matches);
+    }
+
+    return no_of_matches;
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+static bool search_init(Search* const search, const File_Reader* const file_reader,
+                        const char* const needle, const size_t needle_length)
+{
+    if (file_reader == NULL || needle == NULL || needle_length == 0)
+    {
+        return false;
+    }
+
+    const char* const buffer = file_reader_get_file_buffer(file_reader);
+    const size_t file_size = file_reader_get_file_size(file_reader);
+
+    if (buffer == NULL || file_size < needle_length)
+    {
+        return false;
+    }
+
+    search->file_reader = file_reader;
+    search->buffer = buffer;
+    search->file_size = file_size;
+    // line index is built here, so threads of parallel search don't wait for each other
+    if (file_reader_get_no_of_lines(file_reader) == 0)
+    {
+        return false;
+    }
+    search->needle = needle;
+    search->needle_length = needle_length;
+
+    return true;
+}
+
+/*
+    Report matches which start in [begin, end), they may end after end
+*/
+static void search_range(const Search* const search, size_t begin, const size_t end, Match_Sink* const sink)
+{
+#if SEARCH_HAS_X86_SCANNER
+    if (__builtin_cpu_supports("avx2"))
+    {
+        begin = search_range_avx2(search, begin, end, sink);
+    }
+#endif
+
+    search_range_scalar(search, begin, end, sink);
+}
+
+static void search_range_scalar(const Search* const search, const size_t begin, const size_t end,
+                                Match_Sink* const sink)
+{
+    const char* const range_end = search->buffer + end + search->needle_length - 1;
+    const char* position = search->buffer + begin;
+
+    while (sink->is_stopped == false && position < range_end)
+    {
+        const char* const match = memmem(position, (size_t)(range_end - position), search->needle, search->needle_length);
+        if (match == NULL)
+        {
+            break;
+        }
+
+        report_match(search, (size_t)(match - search->buffer), sink);
+        position = match + 1;
+    }
+}
+
+#if SEARCH_HAS_X86_SCANNER
+/*
+    Candidates are positions where both the first and the last character of needle match,
+    32 positions are checked at once, only candidates are compared with the whole needle.
+    Returns the first position which is not checked, rest of range is left for the scalar search.
+*/
+__attribute__((target("avx2")))
+static size_t search_range_avx2(const Search* const search, const size_t begin, const size_t end,
+                                Match_Sink* const sink)
+{
+    const char* const buffer = search->buffer;
+    const char* const needle = search->needle;
+    const size_t needle_length = search->needle_length;
+    const size_t last = needle_length - 1;
+
+    const __m256i first_character = _mm256_set1_epi8(needle[0]);
+    const __m256i last_character = _mm256_set1_epi8(needle[last]);
+
+    size_t position = begin;
+
+    // all positions of block are in range, so needle placed at any of them ends inside of the file
+    while (sink->is_stopped == false && position + 32 <= end)
+    {
+        const __m256i block_first = _mm256_loadu_si256((const __m256i*)(const void*)(buffer + position));
+        const __m256i block_last = _mm256_loadu_si256((const __m256i*)(const void*)(buffer + position + last));
+
+        uint32_t candidates = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_character),
+                             _mm256_cmpeq_epi8(block_last, last_character)));
+
+        while (candidates != 0 && sink->is_stopped == false)
+        {
+            const size_t candidate = position + (size_t)__builtin_ctz(candidates);
+
+            if (needle_length <= 2 || memcmp(buffer + candidate + 1, needle + 1, needle_length - 2) == 0)
+            {
+                report_match(search, candidate, sink);
+            }
+
+            candidates &= candidates - 1;
+        }
+
+        position += 32;
+    }
+
+    return position;
+}
+#endif
+
+static void report_match(const Search* const search, const size_t offset, Match_Sink* const sink)
+{
+    const File_Reader_Match match = {file_reader_line_of_offset(search->file_reader, offset), offset};
+
+    ++sink->no_of_matches;
+    sink->is_stopped = sink->callback(sink->context, &match) == false;
+}
+
+static bool append_match(void* const match_array, const File_Reader_Match* const match)
+{
+    Match_Array* const array = match_array;
+
+    if (array->no_of_matches == array->capacity && array->is_growing == true)
+    {
+        size_t new_capacity = array->capacity > 0 ? array->capacity * 2 : 64;
+        if (new_capacity > array->max_no_of_matches)
+        {
+            new_capacity = array->max_no_of_matches;
+        }
+
+        File_Reader_Match* const new_matches = realloc(array->matches, new_capacity * sizeof(*new_matches));
+        if (new_matches == NULL)
+        {
+            array->has_error = true;
+            return false;
+        }
+
+        array->matches = new_matches;
+        array->capacity = new_capacity;
+    }
+
+    array->matches[array->no_of_matches++] = *match;
+
+    return array->no_of_matches < array->max_no_of_matches;
+}
+
+static void* search_chunk(void* const chunk)
+{
+    Search_Chunk* const searched_chunk = chunk;
+    Match_Sink sink = {append_match, &searched_chunk->matches, 0, false};
+
+    search_range(searched_chunk->search, searched_chunk->begin, searched_chunk->end, &sink);
+
+    return NULL;
+}
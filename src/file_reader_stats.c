@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+
+#include "file_reader_stats.h"
+#include <string.h>
+#include <time.h>
+
+#ifdef FILE_READER_WITH_STATS
+
+// counters of all readers, updated atomically
+static File_Reader_Stats global_stats;
+
+// set before readers are used, read by every finished phase
+static File_Reader_Trace_Callback trace_callback;
+static void* trace_context;
+
+#endif
+
+
+/***********************************************************
+ * FILE_READER_H STATS API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+bool file_reader_get_global_stats(File_Reader_Stats* const stats)
+{
+    if (stats == NULL)
+    {
+        return false;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+#ifdef FILE_READER_WITH_STATS
+    stats_copy(stats, &global_stats);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+    Callback is set for all readers, NULL removes it. It should be set before readers are used,
+    as it is not synchronized with phases which are just finishing.
+*/
+void file_reader_set_trace_callback(const File_Reader_Trace_Callback callback, void* const context)
+{
+#ifdef FILE_READER_WITH_STATS
+    __atomic_store_n(&trace_context, context, __ATOMIC_RELAXED);
+    __atomic_store_n(&trace_callback, callback, __ATOMIC_RELEASE);
+#else
+    (void)callback;
+    (void)context;
+#endif
+}
+
+#ifdef FILE_READER_WITH_STATS
+
+/***********************************************************
+ * FILE_READER_STATS_H FUNCTIONS DEFINITIONS
+***********************************************************/
+
+uint64_t stats_now_in_ns(void)
+{
+    struct timespec time_now;
+    clock_gettime(CLOCK_MONOTONIC, &time_now);
+
+    return (uint64_t)time_now.tv_sec * 1000000000u + (uint64_t)time_now.tv_nsec;
+}
+
+void stats_copy(File_Reader_Stats* const destination, const File_Reader_Stats* const source)
+{
+    destination->bytes_read = __atomic_load_n(&source->bytes_read, __ATOMIC_RELAXED);
+    destination->no_of_read_calls = __atomic_load_n(&source->no_of_read_calls, __ATOMIC_RELAXED);
+    destination->no_of_read_retries = __atomic_load_n(&source->no_of_read_retries, __ATOMIC_RELAXED);
+    destination->no_of_buffer_regrowths = __atomic_load_n(&source->no_of_buffer_regrowths, __ATOMIC_RELAXED);
+    destination->no_of_allocations = __atomic_load_n(&source->no_of_allocations, __ATOMIC_RELAXED);
+
+    for (size_t i = 0; i < FILE_READER_NO_OF_PHASES; ++i)
+    {
+        destination->phase_time_in_ns[i] = __atomic_load_n(&source->phase_time_in_ns[i], __ATOMIC_RELAXED);
+    }
+}
+
+/*
+    Counter is given by its offset, so one function serves all counters of both stats
+*/
+void stats_add(File_Reader_Stats* const stats, const size_t counter_offset, const uint64_t value)
+{
+    uint64_t* const counter = (uint64_t*)(void*)((char*)stats + counter_offset);
+    uint64_t* const global_counter = (uint64_t*)(void*)((char*)&global_stats + counter_offset);
+
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(global_counter, value, __ATOMIC_RELAXED);
+}
+
+void stats_end_phase(File_Reader_Stats* const stats, const File_Reader_Phase phase, const char* const file_name,
+                     const uint64_t begin_in_ns, const bool is_successful)
+{
+    const uint64_t time_in_ns = stats_now_in_ns() - begin_in_ns;
+
+    stats_add(stats, offsetof(File_Reader_Stats, phase_time_in_ns) + (size_t)phase * sizeof(uint64_t), time_in_ns);
+
+    const File_Reader_Trace_Callback callback = __atomic_load_n(&trace_callback, __ATOMIC_ACQUIRE);
+    if (callback != NULL)
+    {
+        const File_Reader_Trace_Event event = {phase, file_name, time_in_ns, is_successful};
+        callback(__atomic_load_n(&trace_context, __ATOMIC_RELAXED), &event);
+    }
+}
+
+#endif
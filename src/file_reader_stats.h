@@ -0,0 +1,36 @@
+#ifndef FILE_READER_STATS_H
+#define FILE_READER_STATS_H
+
+#include <file_reader.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Internal counters and phase timing. Every counter is added to the stats of reader
+    and to the global stats at once. Without FILE_READER_WITH_STATS the macros expand to nothing,
+    so their arguments are not even evaluated.
+*/
+
+#ifdef FILE_READER_WITH_STATS
+
+uint64_t stats_now_in_ns(void);
+void     stats_copy(File_Reader_Stats* destination, const File_Reader_Stats* source);
+void     stats_add(File_Reader_Stats* stats, size_t counter_offset, uint64_t value);
+void     stats_end_phase(File_Reader_Stats* stats, File_Reader_Phase phase, const char* file_name,
+                         uint64_t begin_in_ns, bool is_successful);
+
+#define STATS_ADD(stats, counter, value) stats_add((stats), offsetof(File_Reader_Stats, counter), (uint64_t)(value))
+#define STATS_PHASE_BEGIN(begin_in_ns) const uint64_t begin_in_ns = stats_now_in_ns()
+#define STATS_PHASE_END(stats, phase, file_name, begin_in_ns, is_successful) \
+    stats_end_phase((stats), (phase), (file_name), (begin_in_ns), (is_successful))
+
+#else
+
+#define STATS_ADD(stats, counter, value) ((void)0)
+#define STATS_PHASE_BEGIN(begin_in_ns) ((void)0)
+#define STATS_PHASE_END(stats, phase, file_name, begin_in_ns, is_successful) ((void)0)
+
+#endif
+
+#endif // FILE_READER_STATS_H
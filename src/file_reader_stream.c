@@ -0,0 +1,286 @@
+#define _DEFAULT_SOURCE // O_CLOEXEC
+
+#include <file_reader.h>
+#include "file_reader_decompressor.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define STREAM_DEFAULT_MAX_LINE_LENGTH (64 * 1024)
+
+/*
+    Stream keeps only part of the file in a buffer which is reused for the whole file.
+    Not consumed part of the buffer (the line which crosses the end of data read so far)
+    is moved to the beginning of the buffer before the next read, so every line is contiguous.
+
+    Buffer is 2 bytes longer than the longest line which is returned at once:
+    one for '\n' of the line and one to look ahead, because '\n' which is the last
+    character of file is a part of the last line, the same as for file_reader_get_copy_of_line.
+*/
+struct File_Reader_Stream
+{
+    int           fd;               // descriptor of streamed file, compressed file is read through it too
+    Decompressor* decompressor;     // compressed file is streamed through it, NULL for other files
+    bool          is_eof;           // whole file has been read to the buffer
+    bool          has_error;        // reading of file failed
+    bool          is_truncated;     // the last returned line is a part of longer line, its rest follows it
+    size_t        max_line_length;  // longer lines are returned in parts of that length
+    size_t        buffer_size;      // max_line_length + 2
+    size_t        begin;            // first byte of buffer which is not returned yet
+    size_t        end;              // byte after the last byte read to buffer
+    char          buffer[];
+};
+
+/***********************************************************
+ * LOCAL FUNCTION DECLARATIONS
+***********************************************************/
+
+static bool stream_fill_buffer(File_Reader_Stream* stream);
+
+
+/***********************************************************
+ * FILE_READER_H STREAM API FUNCTIONS DEFINITIONS
+***********************************************************/
+
+File_Reader_Stream* file_reader_stream_open(const char* const file_name, size_t max_line_length)
+{
+    if (file_name == NULL)
+    {
+        //printf("Icorrect file name: \"%s\"\n", file_name);
+        return NULL;
+    }
+
+    if (max_line_length == 0)
+    {
+        max_line_length = STREAM_DEFAULT_MAX_LINE_LENGTH;
+    }
+
+    // stream and its buffer have to fit size_t
+    if (max_line_length > SIZE_MAX - 2 - sizeof(File_Reader_Stream))
+    {
+        //printf("Incorrect max line length: %zu\n", max_line_length);
+        return NULL;
+    }
+
+    const size_t buffer_size = max_line_length + 2;
+
+    File_Reader_Stream* const stream = calloc(1, sizeof(*stream) + buffer_size);
+    if (stream == NULL)
+    {
+        //printf("Can't create stream instance for file: \"%s\"\n", file_name);
+        return NULL;
+    }
+
+    // file is opened once, format is recognized from the same descriptor
+    stream->fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    if (stream->fd == -1)
+    {
+        //printf("Can't open a file: \"%s\"\n", file_name);
+        free(stream);
+        return NULL;
+    }
+
+    const Compression_Format compression_format = compression_detect_format(stream->fd);
+    if (compression_format != COMPRESSION_FORMAT_NONE)
+    {
+        stream->decompressor = decompressor_open(stream->fd, compression_format);
+        if (stream->decompressor == NULL)
+        {
+            //printf("Can't open a compressed file: \"%s\"\n", file_name);
+            close(stream->fd);
+            free(stream);
+            return NULL;
+        }
+    }
+
+    stream->max_line_length = max_line_length;
+    stream->buffer_size = buffer_size;
+
+    return stream;
+}
+
+bool file_reader_stream_next_line(File_Reader_Stream* const stream, File_Reader_Line_View* const line)
+{
+    if (stream == NULL || line == NULL || stream->has_error == true)
+    {
+        return false;
+    }
+
+    stream->is_truncated = false;
+
+    while (true)
+    {
+        const size_t available = stream->end - stream->begin;
+        const char* const line_begin = stream->buffer + stream->begin;
+        const char* const new_line = memchr(line_begin, '\n', available);
+
+        const size_t line_length = new_line != NULL ? (size_t)(new_line - line_begin) : available;
+
+        if (new_line != NULL && line_length <= stream->max_line_length)
+        {
+            const bool is_last_byte = stream->begin + line_length + 1 == stream->end;
+
+            // we have to know if this '\n' ends the file, so look ahead
+            if (is_last_byte == true && stream->is_eof == false)
+            {
+                if (stream_fill_buffer(stream) == false)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            // '\n' at the end of file is a part of the last line
+            const bool is_last_line = is_last_byte == true && stream->is_eof == true;
+
+            line->data = line_begin;
+            line->len = is_last_line ? line_length + 1 : line_length;
+            stream->begin += line_length + 1;
+
+            return true;
+        }
+
+        // too long line, return the part which fits and the rest as next lines, the caller is told about it
+        if (available > stream->max_line_length)
+        {
+            line->data = line_begin;
+            line->len = stream->max_line_length;
+            stream->begin += stream->max_line_length;
+            stream->is_truncated = true;
+
+            return true;
+        }
+
+        if (stream->is_eof == true)
+        {
+            // last line without '\n' at the end
+            if (available > 0)
+            {
+                line->data = line_begin;
+                line->len = available;
+                stream->begin = stream->end;
+
+                return true;
+            }
+
+            return false;
+        }
+
+        if (stream_fill_buffer(stream) == false)
+        {
+            return false;
+        }
+    }
+}
+
+/*
+    Line returned by the last file_reader_stream_next_line is longer than max_line_length,
+    so only its part was returned and the next call returns the continuation of the same line
+*/
+bool file_reader_stream_is_line_truncated(const File_Reader_Stream* const stream)
+{
+    if (stream == NULL)
+    {
+        return false;
+    }
+
+    return stream->is_truncated;
+}
+
+bool file_reader_stream_has_error(const File_Reader_Stream* const stream)
+{
+    if (stream == NULL)
+    {
+        return true;
+    }
+
+    return stream->has_error;
+}
+
+void file_reader_stream_close(File_Reader_Stream* const stream)
+{
+    if (stream == NULL)
+    {
+        //printf("Can't close stream pointed by NULL pointer\n");
+        return;
+    }
+
+    if (stream->decompressor != NULL)
+    {
+        decompressor_close(stream->decompressor);
+    }
+    close(stream->fd);
+    free(stream);
+}
+
+/***********************************************************
+ * LOCAL FUNCTIONS DEFINITIONS
+***********************************************************/
+
+/*
+    Move not returned bytes to the beginning of buffer and read the file after them.
+    Returns false only on read error.
+*/
+static bool stream_fill_buffer(File_Reader_Stream* const stream)
+{
+    const size_t available = stream->end - stream->begin;
+
+    if (stream->begin > 0)
+    {
+        memmove(stream->buffer, stream->buffer + stream->begin, available);
+        stream->begin = 0;
+        stream->end = available;
+    }
+
+    if (stream->decompressor != NULL)
+    {
+        const size_t space_in_buffer = stream->buffer_size - stream->end;
+        size_t bytes_decompressed = 0;
+
+        if (decompressor_read(stream->decompressor, stream->buffer + stream->end, space_in_buffer,
+                              &bytes_decompressed) == false)
+        {
+            //printf("Can't decompress stream\n");
+            stream->has_error = true;
+            return false;
+        }
+
+        // decompressor gives less than requested only at the end of content
+        stream->is_eof = bytes_decompressed < space_in_buffer;
+        stream->end += bytes_decompressed;
+
+        return true;
+    }
+
+    while (true)
+    {
+        const ssize_t bytes_read_from_file =
+            read(stream->fd, stream->buffer + stream->end, stream->buffer_size - stream->end);
+
+        if (bytes_read_from_file == -1)
+        {
+            // try once again if read was interrupted before reading anything
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            //printf("Can't read from stream\n");
+            stream->has_error = true;
+            return false;
+        }
+
+        if (bytes_read_from_file == 0)
+        {
+            stream->is_eof = true;
+        }
+
+        stream->end += (size_t)bytes_read_from_file;
+
+        return true;
+    }
+}
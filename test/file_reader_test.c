@@ -1,12 +1,48 @@
+#define _DEFAULT_SOURCE // usleep
+
 #include <file_reader.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/stat.h>
+#ifdef FILE_READER_WITH_ZLIB
+#include <zlib.h>
+#endif
 
 static void file_reader_normal_file_test(void);
 static void file_reader_virtual_file_test(void);
 static void file_reader_empty_file_test(void);
 static void file_reade_corner_cases_test(void);
+static void file_reader_mapped_file_test(void);
+static void file_reader_line_index_test(void);
+static void file_reader_parallel_line_index_test(void);
+static void file_reader_line_view_test(void);
+static void file_reader_stream_test(void);
+static void file_reader_virtual_file_size_hint_test(void);
+static void file_reader_refresh_test(void);
+static void file_reader_batch_test(void);
+static void file_reader_allocator_test(void);
+static void file_reader_compact_line_index_test(void);
+static void file_reader_lazy_line_index_test(void);
+static void file_reader_find_test(void);
+static void file_reader_line_of_offset_test(void);
+static void file_reader_follow_test(void);
+static void file_reader_line_index_file_test(void);
+static void file_reader_compressed_file_test(void);
+static void file_reader_stats_test(void);
+static void file_reader_read_mode_test(void);
+static void file_reader_open_at_test(void);
+static void file_reader_fields_test(void);
+static void file_reader_kv_index_test(void);
+static void file_reader_cache_test(void);
+static void file_reader_async_test(void);
+static void file_reader_tail_test(void);
 
 
 int main(void)
@@ -15,6 +51,30 @@ int main(void)
     file_reader_virtual_file_test();
     file_reader_empty_file_test();
     file_reade_corner_cases_test();
+    file_reader_mapped_file_test();
+    file_reader_line_index_test();
+    file_reader_parallel_line_index_test();
+    file_reader_line_view_test();
+    file_reader_stream_test();
+    file_reader_virtual_file_size_hint_test();
+    file_reader_refresh_test();
+    file_reader_batch_test();
+    file_reader_allocator_test();
+    file_reader_compact_line_index_test();
+    file_reader_lazy_line_index_test();
+    file_reader_find_test();
+    file_reader_line_of_offset_test();
+    file_reader_follow_test();
+    file_reader_line_index_file_test();
+    file_reader_compressed_file_test();
+    file_reader_stats_test();
+    file_reader_read_mode_test();
+    file_reader_open_at_test();
+    file_reader_fields_test();
+    file_reader_kv_index_test();
+    file_reader_cache_test();
+    file_reader_async_test();
+    file_reader_tail_test();
 
     return 0;
 }
@@ -259,3 +319,2128 @@ static void file_reade_corner_cases_test(void)
         file_reader_delete(fr_emptyLinesInside);
     }
 }
+
+/*
+    Testing file mapped into memory instead of copied to the buffer
+*/
+static void file_reader_mapped_file_test(void)
+{
+    /*
+        Same content as for normal file, mapped reader should behave the same
+    */
+    {
+        const char* file_name = "example_mapped_file.txt";
+        FILE* example_file = fopen(file_name, "w+");
+        assert(example_file != NULL);
+
+        const char* file_content =  "ab\n"
+                                    "cd\n"
+                                    "efg\n"
+                                    "h\n"
+                                    "ij";
+        const size_t content_size = strlen(file_content);
+        fwrite(file_content, sizeof(char), content_size, example_file);
+        fclose(example_file);
+
+        File_Reader* fr_mapped = file_reader_new_mapped(file_name);
+        assert(fr_mapped != NULL);
+
+        assert(file_reader_get_file_size(fr_mapped) == content_size);
+        assert(file_reader_get_no_of_lines(fr_mapped) == 5);
+
+        const char* content_of_file = file_reader_get_file_buffer(fr_mapped);
+        assert(content_of_file != NULL);
+        assert(strcmp(content_of_file, file_content) == 0);
+
+        const char* line_buf = (const char*)file_reader_get_copy_of_line(fr_mapped, 5);
+        assert(strcmp(line_buf, "ij") == 0);
+
+        remove(file_name);
+        file_reader_delete_copy_of_line((char*)line_buf);
+        file_reader_delete(fr_mapped);
+    }
+
+    /*
+        File which fills whole pages, buffer still has to be terminated by '\0'
+    */
+    {
+        const char* file_name = "example_mapped_pageSize_file.txt";
+        FILE* example_file = fopen(file_name, "w+");
+        assert(example_file != NULL);
+
+        enum {PAGE_FILE_SIZE = 4096 * 2};
+        for (size_t i = 0; i < PAGE_FILE_SIZE; ++i)
+        {
+            fputc((i % 64 == 63) ? '\n' : 'x', example_file);
+        }
+        fclose(example_file);
+
+        File_Reader* fr_mapped = file_reader_new_mapped(file_name);
+        assert(fr_mapped != NULL);
+
+        assert(file_reader_get_file_size(fr_mapped) == PAGE_FILE_SIZE);
+        assert(file_reader_get_no_of_lines(fr_mapped) == PAGE_FILE_SIZE / 64);
+
+        const char* content_of_file = file_reader_get_file_buffer(fr_mapped);
+        assert(strlen(content_of_file) == PAGE_FILE_SIZE);
+
+        remove(file_name);
+        file_reader_delete(fr_mapped);
+    }
+
+    /*
+        Virtual file can't be mapped, it is read to the buffer as before
+    */
+    {
+        File_Reader* fr_virtual = file_reader_new_mapped("/proc/stat");
+        assert(fr_virtual != NULL);
+        assert(file_reader_get_no_of_lines(fr_virtual) > 8);
+        file_reader_delete(fr_virtual);
+    }
+
+    /*
+        Empty file and NULL file name
+    */
+    {
+        const char* file_name = "example_mapped_empty_file.txt";
+        FILE* example_file = fopen(file_name, "w+");
+        assert(example_file != NULL);
+        fclose(example_file);
+
+        assert(file_reader_new_mapped(file_name) == NULL);
+        assert(file_reader_new_mapped(NULL) == NULL);
+
+        remove(file_name);
+    }
+}
+
+/*
+    Line index built in a single pass has to follow the same rules as before:
+    '\n' at the end of file does not add a line and the last line keeps its '\n'.
+    Content is longer than vector blocks of the scanner, to test blocks and the tail.
+*/
+static void file_reader_line_index_test(void)
+{
+    const char* file_name = "example_lineIndex_file.txt";
+
+    const struct
+    {
+        const char* content;
+        size_t      no_of_lines;
+        size_t      line;
+        const char* line_content;
+    } cases[] =
+    {
+        {"\n",                    1, 1, "\n"},
+        {"a\n\n",                2, 2, "\n"},
+        {"a\nb\n",               2, 2, "b\n"},
+        {"\n\n\nlast",          4, 4, "last"},
+        {"0123456789012345678901234567890123456789012345678901234567890123456789\n"
+         "0123456789012345678901234567890123456789012345678901234567890\n"
+         "x\n"
+         "0123456789012345678901234567890123456789012345678901234567890123456789\n"
+         "end",                   5, 3, "x"},
+        {"0123456789012345678901234567890123456789012345678901234567890123456789\n"
+         "0123456789012345678901234567890123456789012345678901234567890123456789\n",
+                                  2, 2, "0123456789012345678901234567890123456789012345678901234567890123456789\n"},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        FILE* example_file = fopen(file_name, "w+");
+        assert(example_file != NULL);
+        fwrite(cases[i].content, sizeof(char), strlen(cases[i].content), example_file);
+        fclose(example_file);
+
+        File_Reader* fr_normal = file_reader_new(file_name);
+        assert(fr_normal != NULL);
+        assert(file_reader_get_no_of_lines(fr_normal) == cases[i].no_of_lines);
+
+        char* line_buf = file_reader_get_copy_of_line(fr_normal, cases[i].line);
+        assert(line_buf != NULL);
+        assert(strcmp(line_buf, cases[i].line_content) == 0);
+        assert(file_reader_get_copy_of_line(fr_normal, cases[i].no_of_lines + 1) == NULL);
+
+        file_reader_delete_copy_of_line(line_buf);
+        file_reader_delete(fr_normal);
+    }
+
+    remove(file_name);
+}
+
+/*
+    Index built by several threads has to be the same as index built by one thread
+*/
+static void file_reader_parallel_line_index_test(void)
+{
+    const char* file_name = "example_parallelLineIndex_file.txt";
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+
+    // around 6 MB of lines with different lengths, including empty ones, without '\n' at the end
+    enum {NO_OF_LINES = 100000};
+    for (size_t i = 0; i < NO_OF_LINES; ++i)
+    {
+        for (size_t j = 0; j < (i * 7) % 121; ++j)
+        {
+            fputc('a' + (int)(j % 26), example_file);
+        }
+        if (i != NO_OF_LINES - 1)
+        {
+            fputc('\n', example_file);
+        }
+    }
+    fclose(example_file);
+
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+
+    options.no_of_threads = 1;
+    File_Reader* fr_single = file_reader_new_ex(file_name, &options);
+    assert(fr_single != NULL);
+
+    options.no_of_threads = 4;
+    options.parallel_threshold = 0;
+    File_Reader* fr_parallel = file_reader_new_ex(file_name, &options);
+    assert(fr_parallel != NULL);
+
+    assert(file_reader_get_no_of_lines(fr_single) == NO_OF_LINES);
+    assert(file_reader_get_no_of_lines(fr_parallel) == NO_OF_LINES);
+
+    for (size_t line = 1; line <= NO_OF_LINES; ++line)
+    {
+        char* line_single = file_reader_get_copy_of_line(fr_single, line);
+        char* line_parallel = file_reader_get_copy_of_line(fr_parallel, line);
+        assert((line_single == NULL) == (line_parallel == NULL));
+        assert(line_single == NULL || strcmp(line_single, line_parallel) == 0);
+        file_reader_delete_copy_of_line(line_single);
+        file_reader_delete_copy_of_line(line_parallel);
+    }
+
+    remove(file_name);
+    file_reader_delete(fr_single);
+    file_reader_delete(fr_parallel);
+}
+
+/*
+    Views of lines point to the reader buffer and have the same content as copies of lines
+*/
+static void file_reader_line_view_test(void)
+{
+    const char* file_name = "example_lineView_file.txt";
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+
+    const char* file_content =  "abcd\n"
+                                "\n"
+                                "efg\n"
+                                "15\n";
+    const size_t content_size = strlen(file_content);
+    fwrite(file_content, sizeof(char), content_size, example_file);
+    fclose(example_file);
+
+    File_Reader* fr_normal = file_reader_new(file_name);
+    assert(fr_normal != NULL);
+
+    const char* content_of_file = file_reader_get_file_buffer(fr_normal);
+
+    File_Reader_Line_View line_view = file_reader_get_line_view(fr_normal, 3);
+    assert(line_view.data == content_of_file + 6);
+    assert(line_view.len == 3);
+    assert(strncmp(line_view.data, "efg", line_view.len) == 0);
+
+    // empty line has a valid view, line out of scope does not
+    line_view = file_reader_get_line_view(fr_normal, 2);
+    assert(line_view.data != NULL && line_view.len == 0);
+    line_view = file_reader_get_line_view(fr_normal, 5);
+    assert(line_view.data == NULL && line_view.len == 0);
+    line_view = file_reader_get_line_view(fr_normal, 0);
+    assert(line_view.data == NULL);
+
+    // range is limited to existing lines, the last line keeps '\n' like the copy of line
+    File_Reader_Line_View line_views[8] = {{NULL, 0}};
+    const size_t no_of_views = file_reader_get_line_views(fr_normal, 2, 8, line_views);
+    assert(no_of_views == 3);
+    assert(line_views[0].len == 0);
+    assert(strncmp(line_views[1].data, "efg", line_views[1].len) == 0);
+    assert(line_views[2].len == 3 && strncmp(line_views[2].data, "15\n", line_views[2].len) == 0);
+
+    for (size_t line = 1; line <= file_reader_get_no_of_lines(fr_normal); ++line)
+    {
+        char* line_buf = file_reader_get_copy_of_line(fr_normal, line);
+        line_view = file_reader_get_line_view(fr_normal, line);
+        assert(line_buf == NULL || (strlen(line_buf) == line_view.len
+                                    && strncmp(line_buf, line_view.data, line_view.len) == 0));
+        file_reader_delete_copy_of_line(line_buf);
+    }
+
+    assert(file_reader_get_line_views(fr_normal, 5, 1, line_views) == 0);
+    assert(file_reader_get_line_views(NULL, 1, 1, line_views) == 0);
+
+    remove(file_name);
+    file_reader_delete(fr_normal);
+}
+
+/*
+    Streaming with buffer much smaller than the file gives the same lines as the reader,
+    lines longer than the buffer are returned in parts which are reported as truncated
+*/
+static void file_reader_stream_test(void)
+{
+    const char* file_name = "example_stream_file.txt";
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+
+    const char* file_content =  "ab\n"
+                                "cdefgh\n"
+                                "\n"
+                                "ijklmnop\n"
+                                "qrs\n";
+    const size_t content_size = strlen(file_content);
+    fwrite(file_content, sizeof(char), content_size, example_file);
+    fclose(example_file);
+
+    File_Reader* fr_normal = file_reader_new(file_name);
+    assert(fr_normal != NULL);
+
+    File_Reader_Stream* stream = file_reader_stream_open(file_name, 8);
+    assert(stream != NULL);
+
+    File_Reader_Line_View line = {NULL, 0};
+    size_t line_counter = 0;
+
+    while (file_reader_stream_next_line(stream, &line) == true)
+    {
+        ++line_counter;
+        const File_Reader_Line_View expected_line = file_reader_get_line_view(fr_normal, line_counter);
+        assert(line.len == expected_line.len);
+        assert(strncmp(line.data, expected_line.data, line.len) == 0);
+        assert(file_reader_stream_is_line_truncated(stream) == false);
+    }
+
+    // the last line keeps '\n' at the end of file and doesn't add a line
+    assert(line_counter == file_reader_get_no_of_lines(fr_normal));
+    assert(file_reader_stream_has_error(stream) == false);
+    file_reader_stream_close(stream);
+
+    // lines longer than 4 characters are split in parts, all parts but the last one are truncated
+    stream = file_reader_stream_open(file_name, 4);
+    assert(stream != NULL);
+
+    const char* expected_lines[] = {"ab", "cdef", "gh", "", "ijkl", "mnop", "qrs\n"};
+    const bool expected_truncations[] = {false, true, false, false, true, false, false};
+    line_counter = 0;
+
+    while (file_reader_stream_next_line(stream, &line) == true)
+    {
+        assert(line_counter < sizeof(expected_lines) / sizeof(expected_lines[0]));
+        assert(line.len == strlen(expected_lines[line_counter]));
+        assert(strncmp(line.data, expected_lines[line_counter], line.len) == 0);
+        assert(file_reader_stream_is_line_truncated(stream) == expected_truncations[line_counter]);
+        ++line_counter;
+    }
+    assert(line_counter == sizeof(expected_lines) / sizeof(expected_lines[0]));
+    file_reader_stream_close(stream);
+
+    // virtual file can be streamed as well
+    stream = file_reader_stream_open("/proc/stat", 0);
+    assert(stream != NULL);
+    assert(file_reader_stream_next_line(stream, &line) == true);
+    assert(strncmp(line.data, "cpu ", 4) == 0);
+    file_reader_stream_close(stream);
+
+    assert(file_reader_stream_open(NULL, 0) == NULL);
+    assert(file_reader_stream_open("not_existing_file.txt", 0) == NULL);
+
+    // buffer of such lines doesn't fit memory
+    assert(file_reader_stream_open(file_name, SIZE_MAX) == NULL);
+    assert(file_reader_stream_open(file_name, SIZE_MAX - 1) == NULL);
+
+    remove(file_name);
+    file_reader_delete(fr_normal);
+}
+
+/*
+    Virtual file read with buffer much smaller than the file has to grow without losing content
+*/
+static void file_reader_virtual_file_size_hint_test(void)
+{
+    const char* file_name = "/proc/filesystems";
+
+    File_Reader* fr_virtual = file_reader_new(file_name);
+    assert(fr_virtual != NULL);
+
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.virtual_file_size_hint = 1;
+
+    File_Reader* fr_small_hint = file_reader_new_ex(file_name, &options);
+    assert(fr_small_hint != NULL);
+
+    assert(file_reader_get_file_size(fr_virtual) > 1);
+    assert(file_reader_get_file_size(fr_small_hint) == file_reader_get_file_size(fr_virtual));
+    assert(file_reader_get_no_of_lines(fr_small_hint) == file_reader_get_no_of_lines(fr_virtual));
+    assert(strcmp(file_reader_get_file_buffer(fr_small_hint), file_reader_get_file_buffer(fr_virtual)) == 0);
+
+    file_reader_delete(fr_virtual);
+    file_reader_delete(fr_small_hint);
+
+    // hint which leaves no space for '\0' is rejected
+    options.virtual_file_size_hint = SIZE_MAX;
+    assert(file_reader_new_ex(file_name, &options) == NULL);
+}
+
+/*
+    Refreshed reader has the current content of file which can be bigger or smaller than before
+*/
+static void file_reader_refresh_test(void)
+{
+    const char* file_name = "example_refresh_file.txt";
+    const char* file_contents[] = {"ab\ncd",
+                                   "ab\ncd\nefgh\nijklmnop\n",
+                                   "x"};
+
+    for (size_t mapped = 0; mapped < 2; ++mapped)
+    {
+        FILE* example_file = fopen(file_name, "w+");
+        assert(example_file != NULL);
+        fwrite(file_contents[0], sizeof(char), strlen(file_contents[0]), example_file);
+        fclose(example_file);
+
+        File_Reader* fr_refreshed = mapped ? file_reader_new_mapped(file_name) : file_reader_new(file_name);
+        assert(fr_refreshed != NULL);
+        assert(file_reader_get_no_of_lines(fr_refreshed) == 2);
+
+        for (size_t i = 1; i < sizeof(file_contents) / sizeof(file_contents[0]); ++i)
+        {
+            example_file = fopen(file_name, "w+");
+            assert(example_file != NULL);
+            fwrite(file_contents[i], sizeof(char), strlen(file_contents[i]), example_file);
+            fclose(example_file);
+
+            File_Reader* fr_new = file_reader_new(file_name);
+            assert(fr_new != NULL);
+
+            assert(file_reader_refresh(fr_refreshed) == true);
+            assert(file_reader_get_file_size(fr_refreshed) == strlen(file_contents[i]));
+            assert(strcmp(file_reader_get_file_buffer(fr_refreshed), file_contents[i]) == 0);
+            assert(file_reader_get_no_of_lines(fr_refreshed) == file_reader_get_no_of_lines(fr_new));
+
+            const size_t last_line = file_reader_get_no_of_lines(fr_new);
+            char* line_refreshed = file_reader_get_copy_of_line(fr_refreshed, last_line);
+            char* line_new = file_reader_get_copy_of_line(fr_new, last_line);
+            assert(strcmp(line_refreshed, line_new) == 0);
+
+            file_reader_delete_copy_of_line(line_refreshed);
+            file_reader_delete_copy_of_line(line_new);
+            file_reader_delete(fr_new);
+        }
+
+        // file which doesn't exist anymore leaves reader empty, but still usable
+        remove(file_name);
+        assert(file_reader_refresh(fr_refreshed) == false);
+        assert(file_reader_get_file_size(fr_refreshed) == 0);
+        assert(file_reader_get_no_of_lines(fr_refreshed) == 0);
+        assert(file_reader_get_copy_of_line(fr_refreshed, 1) == NULL);
+
+        file_reader_delete(fr_refreshed);
+    }
+
+    // virtual file is read again without checking if it is virtual
+    File_Reader* fr_virtual = file_reader_new("/proc/stat");
+    assert(fr_virtual != NULL);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        assert(file_reader_refresh(fr_virtual) == true);
+        assert(file_reader_get_no_of_lines(fr_virtual) > 8);
+        assert(strncmp(file_reader_get_file_buffer(fr_virtual), "cpu ", 4) == 0);
+    }
+    file_reader_delete(fr_virtual);
+
+    assert(file_reader_refresh(NULL) == false);
+}
+
+/*
+    Batch of files loaded by several threads, every slot has its own result
+*/
+static void file_reader_batch_test(void)
+{
+    enum {NO_OF_NORMAL_FILES = 20};
+    char file_names_storage[NO_OF_NORMAL_FILES][64];
+    const char* file_names[NO_OF_NORMAL_FILES + 2] = {NULL};
+
+    for (size_t i = 0; i < NO_OF_NORMAL_FILES; ++i)
+    {
+        snprintf(file_names_storage[i], sizeof(file_names_storage[i]), "example_batch_file_%zu.txt", i);
+        file_names[i] = file_names_storage[i];
+
+        FILE* example_file = fopen(file_names[i], "w+");
+        assert(example_file != NULL);
+        for (size_t line = 0; line <= i; ++line)
+        {
+            fprintf(example_file, "file %zu line %zu\n", i, line);
+        }
+        fclose(example_file);
+    }
+
+    file_names[NO_OF_NORMAL_FILES] = "/proc/stat";
+    file_names[NO_OF_NORMAL_FILES + 1] = "not_existing_file.txt";
+
+    File_Reader* file_readers[NO_OF_NORMAL_FILES + 2] = {NULL};
+    int errors[NO_OF_NORMAL_FILES + 2] = {0};
+    const size_t no_of_loaded_files = file_reader_new_batch(file_names, NO_OF_NORMAL_FILES + 2, file_readers, errors);
+    assert(no_of_loaded_files == NO_OF_NORMAL_FILES + 1);
+
+    for (size_t i = 0; i < NO_OF_NORMAL_FILES; ++i)
+    {
+        assert(file_readers[i] != NULL && errors[i] == 0);
+        assert(file_reader_get_line_index_size(file_readers[i]) > 0);  // indexed by the workers
+        assert(file_reader_get_no_of_lines(file_readers[i]) == i + 1);
+
+        char expected_line[64] = {0};
+        snprintf(expected_line, sizeof(expected_line), "file %zu line %zu\n", i, i);
+        const File_Reader_Line_View line_view = file_reader_get_line_view(file_readers[i], i + 1);
+        assert(line_view.len == strlen(expected_line));
+        assert(strncmp(line_view.data, expected_line, line_view.len) == 0);
+
+        file_reader_delete(file_readers[i]);
+        remove(file_names[i]);
+    }
+
+    assert(file_readers[NO_OF_NORMAL_FILES] != NULL && errors[NO_OF_NORMAL_FILES] == 0);
+    assert(file_readers[NO_OF_NORMAL_FILES + 1] == NULL && errors[NO_OF_NORMAL_FILES + 1] == ENOENT);
+    file_reader_delete(file_readers[NO_OF_NORMAL_FILES]);
+
+    // errors are optional
+    const char* mixed_file_names[] = {"/proc/stat", "not_existing_file.txt"};
+    assert(file_reader_new_batch(mixed_file_names, 2, file_readers, NULL) == 1);
+    assert(file_readers[0] != NULL && file_readers[1] == NULL);
+    file_reader_delete(file_readers[0]);
+
+    assert(file_reader_new_batch(file_names, 0, file_readers, errors) == 0);
+    assert(file_reader_new_batch(NULL, 1, file_readers, errors) == 0);
+}
+
+/*
+    Allocator which counts allocations which are not released yet
+*/
+static void* counting_allocate(void* context, size_t size)
+{
+    ++*(size_t*)context;
+    return malloc(size);
+}
+
+static void* counting_reallocate(void* context, void* memory, size_t old_size, size_t new_size)
+{
+    (void)old_size;
+    if (memory == NULL)
+    {
+        ++*(size_t*)context;
+    }
+    return realloc(memory, new_size);
+}
+
+static void counting_deallocate(void* context, void* memory)
+{
+    if (memory != NULL)
+    {
+        --*(size_t*)context;
+    }
+    free(memory);
+}
+
+/*
+    Memory of reader comes from the allocator given in options
+*/
+static void file_reader_allocator_test(void)
+{
+    const char* file_name = "example_allocator_file.txt";
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+
+    const char* file_content =  "ab\n"
+                                "cd\n"
+                                "efg";
+    fwrite(file_content, sizeof(char), strlen(file_content), example_file);
+    fclose(example_file);
+
+    // every allocation of reader goes through the allocator and is released by it
+    {
+        size_t no_of_allocations = 0;
+
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.allocator.allocate = counting_allocate;
+        options.allocator.reallocate = counting_reallocate;
+        options.allocator.deallocate = counting_deallocate;
+        options.allocator.context = &no_of_allocations;
+
+        File_Reader* fr_counted = file_reader_new_ex(file_name, &options);
+        assert(fr_counted != NULL);
+        assert(no_of_allocations == 2);  // reader and buffer, line index is built on demand
+
+        char* line_buf = file_reader_get_copy_of_line(fr_counted, 2);
+        assert(strcmp(line_buf, "cd") == 0);
+        assert(no_of_allocations == 4);  // line index and copy of line
+
+        char* copied_content_of_file = file_reader_get_copy_of_file_buffer(fr_counted);
+        assert(strcmp(copied_content_of_file, file_content) == 0);
+        assert(no_of_allocations == 5);
+
+        // copies go back to the allocator of reader
+        file_reader_release_copy_of_line(fr_counted, line_buf);
+        file_reader_release_copy_of_file_buffer(fr_counted, copied_content_of_file);
+        assert(no_of_allocations == 3);
+        file_reader_delete(fr_counted);
+        assert(no_of_allocations == 0);
+    }
+
+    // memory of allocate can't be given to realloc and free, so allocator has to be complete
+    {
+        size_t no_of_allocations = 0;
+
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.allocator.allocate = counting_allocate;
+        options.allocator.context = &no_of_allocations;
+
+        assert(file_reader_new_ex(file_name, &options) == NULL);
+        assert(no_of_allocations == 0);
+    }
+
+    // readers and their copies are released at once by reset of arena
+    {
+        File_Reader_Arena* arena = file_reader_arena_new(256);
+        assert(arena != NULL);
+
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.allocator = file_reader_arena_get_allocator(arena);
+
+        for (size_t round = 0; round < 3; ++round)
+        {
+            File_Reader* fr_normal = file_reader_new_ex(file_name, &options);
+            File_Reader* fr_virtual = file_reader_new_ex("/proc/stat", &options);
+            assert(fr_normal != NULL && fr_virtual != NULL);
+
+            assert(file_reader_get_no_of_lines(fr_normal) == 3);
+            assert(file_reader_get_no_of_lines(fr_virtual) > 8);
+
+            const char* line_buf = file_reader_get_copy_of_line(fr_normal, 3);
+            assert(strcmp(line_buf, "efg") == 0);
+            const char* copied_content_of_file = file_reader_get_copy_of_file_buffer(fr_virtual);
+            assert(strncmp(copied_content_of_file, "cpu ", 4) == 0);
+            assert(((size_t)copied_content_of_file % sizeof(void*)) == 0);
+
+            file_reader_arena_reset(arena);
+        }
+
+        file_reader_arena_delete(arena);
+    }
+
+    remove(file_name);
+}
+
+/*
+    Compact indexes give the same lines as the wide one, also after refresh, in less memory
+*/
+static void file_reader_compact_line_index_test(void)
+{
+    const char* file_name = "example_compactLineIndex_file.txt";
+
+    // lines of different length, so blocks of delta index have different bases
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        fprintf(example_file, "%zu%.*s\n", i, (int)(i % 37), "abcdefghijklmnopqrstuvwxyzabcdefghijk");
+    }
+    fprintf(example_file, "last");
+    fclose(example_file);
+
+    const File_Reader_Index_Mode index_modes[] = {FILE_READER_INDEX_COMPACT, FILE_READER_INDEX_DELTA};
+
+    File_Reader* fr_wide = file_reader_new(file_name);
+    assert(fr_wide != NULL);
+    assert(file_reader_get_no_of_lines(fr_wide) == 1001);
+
+    for (size_t i = 0; i < sizeof(index_modes) / sizeof(index_modes[0]); ++i)
+    {
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.index_mode = index_modes[i];
+
+        File_Reader* fr_compact = file_reader_new_ex(file_name, &options);
+        assert(fr_compact != NULL);
+        assert(file_reader_get_no_of_lines(fr_compact) == 1001);
+        assert(file_reader_get_line_index_size(fr_compact) < file_reader_get_line_index_size(fr_wide));
+
+        for (size_t refresh = 0; refresh < 2; ++refresh)
+        {
+            assert(file_reader_get_no_of_lines(fr_compact) == file_reader_get_no_of_lines(fr_wide));
+
+            for (size_t line = 1; line <= file_reader_get_no_of_lines(fr_wide); ++line)
+            {
+                const File_Reader_Line_View view_wide = file_reader_get_line_view(fr_wide, line);
+                const File_Reader_Line_View view_compact = file_reader_get_line_view(fr_compact, line);
+                assert(view_wide.len == view_compact.len);
+                assert(memcmp(view_wide.data, view_compact.data, view_wide.len) == 0);
+            }
+
+            char* line_buf = file_reader_get_copy_of_line(fr_compact, 1001);
+            assert(strcmp(line_buf, "last") == 0);
+            file_reader_delete_copy_of_line(line_buf);
+
+            assert(file_reader_refresh(fr_compact) == true);
+        }
+
+        file_reader_delete(fr_compact);
+    }
+
+    file_reader_delete(fr_wide);
+    assert(file_reader_get_line_index_size(NULL) == 0);
+
+    remove(file_name);
+}
+
+typedef struct Line_Reading_Thread
+{
+    pthread_t    thread;
+    File_Reader* file_reader;
+    size_t       first_line;  // thread reads lines from that one to the end of file
+    bool         is_correct;
+} Line_Reading_Thread;
+
+static void* read_lines(void* reading_thread)
+{
+    Line_Reading_Thread* const thread = reading_thread;
+    char expected_line[32];
+
+    thread->is_correct = true;
+    for (size_t line = thread->first_line; line <= 20000; ++line)
+    {
+        snprintf(expected_line, sizeof(expected_line), "line %zu", line);
+        const File_Reader_Line_View view = file_reader_get_line_view(thread->file_reader, line);
+        thread->is_correct &= view.len == strlen(expected_line) && memcmp(view.data, expected_line, view.len) == 0;
+    }
+
+    return NULL;
+}
+
+/*
+    Line index is built by the first call which needs it, incremental index only as far as needed,
+    also when several threads ask for lines at the same time
+*/
+static void file_reader_lazy_line_index_test(void)
+{
+    const char* file_name = "example_lazyLineIndex_file.txt";
+
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+    for (size_t i = 1; i < 20000; ++i)
+    {
+        fprintf(example_file, "line %zu\n", i);
+    }
+    fprintf(example_file, "line 20000");
+    fclose(example_file);
+
+    const File_Reader_Index_Build index_builds[] = {FILE_READER_INDEX_BUILD_LAZY,
+                                                    FILE_READER_INDEX_BUILD_EAGER,
+                                                    FILE_READER_INDEX_BUILD_INCREMENTAL};
+
+    for (size_t i = 0; i < sizeof(index_builds) / sizeof(index_builds[0]); ++i)
+    {
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.index_build = index_builds[i];
+        options.index_mode = i == 2 ? FILE_READER_INDEX_COMPACT : FILE_READER_INDEX_WIDE;
+
+        File_Reader* fr_lazy = file_reader_new_ex(file_name, &options);
+        assert(fr_lazy != NULL);
+
+        // whole buffer is available without line index
+        assert(file_reader_get_file_size(fr_lazy) == 20000 * 6 + 9 * 1 + 90 * 2 + 900 * 3 + 9000 * 4 + 10001 * 5 - 1);
+        assert(strncmp(file_reader_get_file_buffer(fr_lazy), "line 1\n", 7) == 0);
+        assert((file_reader_get_line_index_size(fr_lazy) == 0) == (index_builds[i] != FILE_READER_INDEX_BUILD_EAGER));
+
+        if (index_builds[i] == FILE_READER_INDEX_BUILD_INCREMENTAL)
+        {
+            // only beginning of file is scanned, so the index is smaller than for the whole file
+            char* line_buf = file_reader_get_copy_of_line(fr_lazy, 3);
+            assert(strcmp(line_buf, "line 3") == 0);
+            file_reader_delete_copy_of_line(line_buf);
+            assert(file_reader_get_line_index_size(fr_lazy) > 0);
+            assert(file_reader_get_line_index_size(fr_lazy) < 20000 * sizeof(size_t));
+        }
+
+        Line_Reading_Thread threads[4];
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t)
+        {
+            threads[t].file_reader = fr_lazy;
+            threads[t].first_line = 1 + t * 4999;
+            assert(pthread_create(&threads[t].thread, NULL, read_lines, &threads[t]) == 0);
+        }
+
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t)
+        {
+            pthread_join(threads[t].thread, NULL);
+            assert(threads[t].is_correct == true);
+        }
+
+        assert(file_reader_get_no_of_lines(fr_lazy) == 20000);
+        assert(file_reader_get_line_view(fr_lazy, 20001).data == NULL);
+
+        // refresh drops the index, it is built again
+        assert(file_reader_refresh(fr_lazy) == true);
+        char* line_buf = file_reader_get_copy_of_line(fr_lazy, 20000);
+        assert(strcmp(line_buf, "line 20000") == 0);
+        file_reader_delete_copy_of_line(line_buf);
+        assert(file_reader_get_no_of_lines(fr_lazy) == 20000);
+
+        file_reader_delete(fr_lazy);
+    }
+
+    remove(file_name);
+}
+
+static bool stop_after_two_matches(void* context, const File_Reader_Match* match)
+{
+    size_t* const no_of_matches = context;
+    (void)match;
+
+    return ++(*no_of_matches) < 2;
+}
+
+/*
+    Matches give line numbers and offsets of needle, parallel search gives the same matches
+*/
+static void file_reader_find_test(void)
+{
+    const char* file_name = "example_find_file.txt";
+    const char* file_content = "abc abc\n"
+                               "\n"
+                               "xaaay\n"
+                               "ab\n"
+                               "cab";
+
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+    fwrite(file_content, sizeof(char), strlen(file_content), example_file);
+    fclose(example_file);
+
+    File_Reader* fr_searched = file_reader_new(file_name);
+    assert(fr_searched != NULL);
+
+    File_Reader_Match matches[8];
+
+    // needle crossing the end of line belongs to the line where it starts
+    assert(file_reader_find(fr_searched, "ab", 2, matches, 8) == 4);
+    const File_Reader_Match expected_ab[] = {{1, 0}, {1, 4}, {4, 15}, {5, 19}};
+    assert(memcmp(matches, expected_ab, sizeof(expected_ab)) == 0);
+
+    assert(file_reader_find(fr_searched, "aa", 2, matches, 8) == 2);
+    assert(matches[0].line == 3 && matches[0].offset == 10 && matches[1].offset == 11);
+
+    assert(file_reader_find(fr_searched, "b\nc", 3, matches, 8) == 1);
+    assert(matches[0].line == 4 && matches[0].offset == 16);
+
+    assert(file_reader_find(fr_searched, "\n", 1, matches, 8) == 4);
+    assert(matches[1].line == 2 && matches[1].offset == 8);
+
+    assert(file_reader_find(fr_searched, "abc", 3, matches, 1) == 1);
+    assert(file_reader_find(fr_searched, "abcd", 4, matches, 8) == 0);
+    assert(file_reader_find(fr_searched, "", 0, matches, 8) == 0);
+
+    size_t no_of_matches = 0;
+    assert(file_reader_find_each(fr_searched, "a", 1, stop_after_two_matches, &no_of_matches) == 2);
+    assert(no_of_matches == 2);
+
+    file_reader_delete(fr_searched);
+
+    // around 4 MB, so parallel search splits it among threads
+    example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+    enum {NO_OF_LINES = 60000};
+    for (size_t i = 0; i < NO_OF_LINES; ++i)
+    {
+        fprintf(example_file, "%zu %s\n", i, i % 7 == 0 ? "needle in haystack, needle" : "just haystack, nothing else");
+        fprintf(example_file, "%.*s\n", (int)(i % 50), "----------------------------------------------------");
+    }
+    fclose(example_file);
+
+    fr_searched = file_reader_new(file_name);
+    assert(fr_searched != NULL);
+
+    const size_t max_no_of_matches = NO_OF_LINES;
+    File_Reader_Match* matches_single = malloc(max_no_of_matches * sizeof(*matches_single));
+    File_Reader_Match* matches_parallel = malloc(max_no_of_matches * sizeof(*matches_parallel));
+    assert(matches_single != NULL && matches_parallel != NULL);
+
+    const size_t no_of_found = file_reader_find(fr_searched, "needle", 6, matches_single, max_no_of_matches);
+    assert(no_of_found == 2 * ((NO_OF_LINES + 6) / 7));
+    for (size_t i = 0; i < no_of_found; ++i)
+    {
+        const File_Reader_Line_View line_view = file_reader_get_line_view(fr_searched, matches_single[i].line);
+        assert(matches_single[i].line == 2 * 7 * (i / 2) + 1);
+        assert(matches_single[i].offset >= (size_t)(line_view.data - file_reader_get_file_buffer(fr_searched)));
+        assert(memcmp(file_reader_get_file_buffer(fr_searched) + matches_single[i].offset, "needle", 6) == 0);
+    }
+
+    assert(file_reader_find_parallel(fr_searched, "needle", 6, 4, matches_parallel, max_no_of_matches) == no_of_found);
+    assert(memcmp(matches_single, matches_parallel, no_of_found * sizeof(*matches_single)) == 0);
+
+    // limit of matches is kept also when matches come from several threads
+    assert(file_reader_find_parallel(fr_searched, "haystack", 8, 4, matches_parallel, 100) == 100);
+    assert(file_reader_find(fr_searched, "haystack", 8, matches_single, 100) == 100);
+    assert(memcmp(matches_single, matches_parallel, 100 * sizeof(*matches_single)) == 0);
+
+    free(matches_single);
+    free(matches_parallel);
+    file_reader_delete(fr_searched);
+
+    remove(file_name);
+}
+
+/*
+    Offsets are mapped back to lines and ranges of lines are views of the buffer
+*/
+static void file_reader_line_of_offset_test(void)
+{
+    const char* file_name = "example_lineOfOffset_file.txt";
+    const char* file_content = "ab\n"
+                               "\n"
+                               "cde\n"
+                               "f\n";
+
+    FILE* example_file = fopen(file_name, "w+");
+    assert(example_file != NULL);
+    fwrite(file_content, sizeof(char), strlen(file_content), example_file);
+    fclose(example_file);
+
+    const File_Reader_Index_Build index_builds[] = {FILE_READER_INDEX_BUILD_LAZY, FILE_READER_INDEX_BUILD_INCREMENTAL};
+
+    for (size_t i = 0; i < sizeof(index_builds) / sizeof(index_builds[0]); ++i)
+    {
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.index_build = index_builds[i];
+
+        File_Reader* fr_offsets = file_reader_new_ex(file_name, &options);
+        assert(fr_offsets != NULL);
+
+        // '\n' belongs to the line which it ends
+        const size_t expected_lines[] = {1, 1, 1, 2, 3, 3, 3, 3, 4, 4};
+        for (size_t offset = 0; offset < strlen(file_content); ++offset)
+        {
+            assert(file_reader_line_of_offset(fr_offsets, offset) == expected_lines[offset]);
+        }
+        assert(file_reader_line_of_offset(fr_offsets, strlen(file_content)) == 0);
+
+        File_Reader_Line_View line_range = file_reader_get_line_range(fr_offsets, 2, 3);
+        assert(line_range.data == file_reader_get_file_buffer(fr_offsets) + 3);
+        assert(line_range.len == 4 && strncmp(line_range.data, "\ncde", 4) == 0);
+
+        // the last line keeps its '\n', range is cut at the last line
+        line_range = file_reader_get_line_range(fr_offsets, 1, 100);
+        assert(line_range.len == strlen(file_content));
+
+        line_range = file_reader_get_line_range(fr_offsets, 2, 2);
+        assert(line_range.data != NULL && line_range.len == 0);
+
+        assert(file_reader_get_line_range(fr_offsets, 3, 2).data == NULL);
+        assert(file_reader_get_line_range(fr_offsets, 0, 2).data == NULL);
+        assert(file_reader_get_line_range(fr_offsets, 5, 6).data == NULL);
+
+        file_reader_delete(fr_offsets);
+    }
+
+    assert(file_reader_line_of_offset(NULL, 0) == 0);
+    assert(file_reader_get_line_range(NULL, 1, 1).data == NULL);
+
+    remove(file_name);
+}
+
+static void append_to_file(const char* file_name, const char* mode, const char* content)
+{
+    FILE* example_file = fopen(file_name, mode);
+    assert(example_file != NULL);
+    fwrite(content, sizeof(char), strlen(content), example_file);
+    fclose(example_file);
+}
+
+static void* append_after_delay(void* file_name)
+{
+    usleep(50000);
+    append_to_file(file_name, "a", "late line\n");
+
+    return NULL;
+}
+
+/*
+    Followed reader gets appended lines and the same lines as a new reader,
+    truncated or replaced file is loaded again
+*/
+static void file_reader_follow_test(void)
+{
+    const char* file_name = "example_follow_file.txt";
+    const char* replacing_file_name = "example_follow_file.txt.new";
+    const char* appended_contents[] = {"ab\ncd", "ef\n", "\n", "gh\nij\n", "k"};
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.mapped = i == 1;
+        options.index_build = i == 0 ? FILE_READER_INDEX_BUILD_EAGER
+            : (i == 2 ? FILE_READER_INDEX_BUILD_INCREMENTAL : FILE_READER_INDEX_BUILD_LAZY);
+        options.index_mode = i == 3 ? FILE_READER_INDEX_COMPACT : FILE_READER_INDEX_WIDE;
+
+        append_to_file(file_name, "w", appended_contents[0]);
+        File_Reader* fr_followed = file_reader_new_ex(file_name, &options);
+        assert(fr_followed != NULL);
+        assert(file_reader_get_no_of_lines(fr_followed) == 2);
+        assert(file_reader_follow(fr_followed) == FILE_READER_FOLLOW_UNCHANGED);
+
+        for (size_t j = 1; j < sizeof(appended_contents) / sizeof(appended_contents[0]); ++j)
+        {
+            append_to_file(file_name, "a", appended_contents[j]);
+            assert(file_reader_follow(fr_followed) == FILE_READER_FOLLOW_APPENDED);
+
+            File_Reader* fr_new = file_reader_new(file_name);
+            assert(fr_new != NULL);
+            assert(strcmp(file_reader_get_file_buffer(fr_followed), file_reader_get_file_buffer(fr_new)) == 0);
+            assert(file_reader_get_no_of_lines(fr_followed) == file_reader_get_no_of_lines(fr_new));
+
+            for (size_t line = 1; line <= file_reader_get_no_of_lines(fr_new); ++line)
+            {
+                const File_Reader_Line_View view_followed = file_reader_get_line_view(fr_followed, line);
+                const File_Reader_Line_View view_new = file_reader_get_line_view(fr_new, line);
+                assert(view_followed.len == view_new.len);
+                assert(memcmp(view_followed.data, view_new.data, view_new.len) == 0);
+            }
+
+            file_reader_delete(fr_new);
+        }
+
+        // "ab\ncdef\n\ngh\nij\nk"
+        assert(file_reader_get_no_of_lines(fr_followed) == 6);
+
+        // truncated file
+        append_to_file(file_name, "w", "x\n");
+        assert(file_reader_follow(fr_followed) == FILE_READER_FOLLOW_RELOADED);
+        assert(file_reader_get_no_of_lines(fr_followed) == 1);
+
+        // rotated file, new one is bigger, but it is not a continuation
+        append_to_file(replacing_file_name, "w", "new\nfile\n");
+        assert(rename(replacing_file_name, file_name) == 0);
+        assert(file_reader_follow(fr_followed) == FILE_READER_FOLLOW_RELOADED);
+        assert(strcmp(file_reader_get_file_buffer(fr_followed), "new\nfile\n") == 0);
+        assert(file_reader_get_no_of_lines(fr_followed) == 2);
+
+        file_reader_delete(fr_followed);
+    }
+
+    File_Reader* fr_waiting = file_reader_new(file_name);
+    assert(fr_waiting != NULL);
+
+    // nothing happens, so waiting ends with timeout
+    assert(file_reader_follow_wait(fr_waiting, 0) == false);
+
+    // changes made before waiting are noticed at once
+    append_to_file(file_name, "a", "more\n");
+    assert(file_reader_follow_wait(fr_waiting, -1) == true);
+    assert(file_reader_follow(fr_waiting) == FILE_READER_FOLLOW_APPENDED);
+
+    pthread_t appending_thread;
+    assert(pthread_create(&appending_thread, NULL, append_after_delay, (void*)file_name) == 0);
+    assert(file_reader_follow_wait(fr_waiting, 5000) == true);
+    pthread_join(appending_thread, NULL);
+
+    assert(file_reader_follow(fr_waiting) == FILE_READER_FOLLOW_APPENDED);
+    assert(file_reader_get_no_of_lines(fr_waiting) == 4);
+
+    // file which doesn't exist can't be followed
+    remove(file_name);
+    assert(file_reader_follow(fr_waiting) == FILE_READER_FOLLOW_ERROR);
+    assert(file_reader_get_no_of_lines(fr_waiting) == 0);
+    assert(file_reader_follow_wait(fr_waiting, 0) == false);
+
+    file_reader_delete(fr_waiting);
+    assert(file_reader_follow(NULL) == FILE_READER_FOLLOW_ERROR);
+}
+
+/*
+    Change one offset of saved line index and its checksum, as a crafted index file would do.
+    Index file has 64 bytes of header with 6 checked fields and the checksum, offsets follow it.
+*/
+static void rewrite_line_index_offset(const char* index_file_name, size_t index, size_t offset)
+{
+    FILE* index_file = fopen(index_file_name, "r+b");
+    assert(index_file != NULL);
+
+    uint64_t header[8];
+    assert(fread(header, sizeof(header), 1, index_file) == 1);
+
+    const size_t no_of_offsets = (size_t)header[5] + 1;
+    size_t* offsets = malloc(no_of_offsets * sizeof(*offsets));
+    assert(offsets != NULL && fread(offsets, sizeof(*offsets), no_of_offsets, index_file) == no_of_offsets);
+    offsets[index] = offset;
+
+    const uint32_t* version_and_size = (const uint32_t*)(const void*)&header[1];
+    const uint64_t checked_fields[] = {version_and_size[0], version_and_size[1], header[2], header[3], header[4], header[5]};
+    uint64_t checksum = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < 6; ++i)
+    {
+        checksum = (checksum ^ checked_fields[i]) * 0x100000001b3ull;
+    }
+    for (size_t i = 0; i < no_of_offsets; ++i)
+    {
+        checksum = (checksum ^ (uint64_t)offsets[i]) * 0x100000001b3ull;
+    }
+    header[6] = checksum;
+
+    fseek(index_file, 0, SEEK_SET);
+    assert(fwrite(header, sizeof(header), 1, index_file) == 1);
+    assert(fwrite(offsets, sizeof(*offsets), no_of_offsets, index_file) == no_of_offsets);
+    fclose(index_file);
+    free(offsets);
+}
+
+/*
+    Line index saved by one reader is used by the next ones as long as the file doesn't change
+*/
+static void file_reader_line_index_file_test(void)
+{
+    const char* file_name = "example_lineIndexFile_file.txt";
+    const char* index_file_name = "example_lineIndexFile_file.txt.lidx";
+
+    append_to_file(file_name, "w", "ab\n\ncde\nf");
+    remove(index_file_name);
+
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.line_index_file = true;
+
+    // the first reader scans the file and saves its index
+    File_Reader* fr_indexed = file_reader_new_ex(file_name, &options);
+    assert(fr_indexed != NULL);
+    assert(file_reader_get_no_of_lines(fr_indexed) == 4);
+    assert(file_reader_get_line_index_size(fr_indexed) > 0);
+    file_reader_delete(fr_indexed);
+
+    FILE* index_file = fopen(index_file_name, "r");
+    assert(index_file != NULL);
+    fclose(index_file);
+
+    // next readers map the saved index, no memory is allocated for it
+    for (size_t i = 0; i < 3; ++i)
+    {
+        options.mapped = i == 1;
+        options.index_build = i == 2 ? FILE_READER_INDEX_BUILD_INCREMENTAL : FILE_READER_INDEX_BUILD_LAZY;
+
+        fr_indexed = file_reader_new_ex(file_name, &options);
+        assert(fr_indexed != NULL);
+
+        char* line_buf = file_reader_get_copy_of_line(fr_indexed, 3);
+        assert(strcmp(line_buf, "cde") == 0);
+        file_reader_delete_copy_of_line(line_buf);
+
+        assert(file_reader_get_no_of_lines(fr_indexed) == 4);
+        assert(file_reader_get_line_index_size(fr_indexed) == 0);
+        assert(file_reader_line_of_offset(fr_indexed, 8) == 4);
+
+        file_reader_delete(fr_indexed);
+    }
+
+    // changed file doesn't match the saved index, it is scanned and index is saved again
+    options.mapped = false;
+    options.index_build = FILE_READER_INDEX_BUILD_LAZY;
+    append_to_file(file_name, "a", "g\nhi\n");
+
+    fr_indexed = file_reader_new_ex(file_name, &options);
+    assert(fr_indexed != NULL);
+    assert(file_reader_get_no_of_lines(fr_indexed) == 5);
+    assert(file_reader_get_line_index_size(fr_indexed) > 0);
+
+    // appended lines can't be added to the mapped index, so it is replaced by a built one
+    File_Reader* fr_followed = file_reader_new_ex(file_name, &options);
+    assert(fr_followed != NULL);
+    assert(file_reader_get_no_of_lines(fr_followed) == 5);
+    assert(file_reader_get_line_index_size(fr_followed) == 0);
+
+    append_to_file(file_name, "a", "jk");
+    assert(file_reader_follow(fr_followed) == FILE_READER_FOLLOW_APPENDED);
+    assert(file_reader_get_no_of_lines(fr_followed) == 6);
+    char* line_buf = file_reader_get_copy_of_line(fr_followed, 6);
+    assert(strcmp(line_buf, "jk") == 0);
+    file_reader_delete_copy_of_line(line_buf);
+
+    // damaged index is not used
+    index_file = fopen(index_file_name, "r+");
+    assert(index_file != NULL);
+    fseek(index_file, -1, SEEK_END);
+    fputc(0x7f, index_file);
+    fclose(index_file);
+
+    assert(file_reader_refresh(fr_indexed) == true);
+    assert(file_reader_get_no_of_lines(fr_indexed) == 6);
+    assert(file_reader_get_line_index_size(fr_indexed) > 0);
+    file_reader_delete(fr_indexed);
+
+    // offsets with correct checksum are still checked, ones out of order, out of file,
+    // of empty lines or not right after '\n' are not used
+    const size_t crafted_offsets[][2] = {{2, 100}, {2, 1}, {0, 1}, {2, 3}, {5, 17}, {4, 10}};
+
+    for (size_t i = 0; i < sizeof(crafted_offsets) / sizeof(crafted_offsets[0]); ++i)
+    {
+        fr_indexed = file_reader_new_ex(file_name, &options);
+        assert(fr_indexed != NULL && file_reader_get_no_of_lines(fr_indexed) == 6);
+        file_reader_delete(fr_indexed);
+
+        rewrite_line_index_offset(index_file_name, crafted_offsets[i][0], crafted_offsets[i][1]);
+
+        fr_indexed = file_reader_new_ex(file_name, &options);
+        assert(fr_indexed != NULL);
+        assert(file_reader_get_no_of_lines(fr_indexed) == 6);
+        assert(file_reader_get_line_index_size(fr_indexed) > 0);
+        line_buf = file_reader_get_copy_of_line(fr_indexed, 3);
+        assert(strcmp(line_buf, "cde") == 0);
+        file_reader_delete_copy_of_line(line_buf);
+        file_reader_delete(fr_indexed);
+    }
+
+    file_reader_delete(fr_followed);
+
+    // index file can be read only by those who can read the source file
+    assert(chmod(file_name, S_IRUSR | S_IWUSR) == 0);
+    remove(index_file_name);
+
+    fr_indexed = file_reader_new_ex(file_name, &options);
+    assert(fr_indexed != NULL && file_reader_get_no_of_lines(fr_indexed) == 6);
+    file_reader_delete(fr_indexed);
+
+    struct stat index_file_stat;
+    assert(stat(index_file_name, &index_file_stat) == 0);
+    assert((index_file_stat.st_mode & 0777) == (S_IRUSR | S_IWUSR));
+
+    remove(file_name);
+    remove(index_file_name);
+}
+
+#ifdef FILE_READER_WITH_ZLIB
+/*
+    Allocator which remembers the biggest allocation
+*/
+static void* largest_allocate(void* context, size_t size)
+{
+    size_t* const largest_allocation = context;
+    *largest_allocation = size > *largest_allocation ? size : *largest_allocation;
+    return malloc(size);
+}
+
+static void* largest_reallocate(void* context, void* memory, size_t old_size, size_t new_size)
+{
+    (void)old_size;
+    size_t* const largest_allocation = context;
+    *largest_allocation = new_size > *largest_allocation ? new_size : *largest_allocation;
+    return realloc(memory, new_size);
+}
+
+static void largest_deallocate(void* context, void* memory)
+{
+    (void)context;
+    free(memory);
+}
+#endif
+
+/*
+    Gzip file made of two members is read the same as its content, by the reader and by the stream.
+    Size in the trailer describes only the last member, so the buffer has to grow over it.
+*/
+static void file_reader_compressed_file_test(void)
+{
+#ifdef FILE_READER_WITH_ZLIB
+    const char* file_name = "example_file.txt.gz";
+    const char* truncated_file_name = "example_truncated_file.txt.gz";
+    const size_t no_of_lines = 10000;
+
+    gzFile compressed_file = gzopen(file_name, "wb");
+    assert(compressed_file != NULL);
+    for (size_t i = 0; i < no_of_lines - 1; ++i)
+    {
+        assert(gzprintf(compressed_file, "line %zu\n", i + 1) > 0);
+    }
+    gzclose(compressed_file);
+
+    // appending creates the second member
+    compressed_file = gzopen(file_name, "ab");
+    assert(compressed_file != NULL);
+    assert(gzputs(compressed_file, "last") > 0);
+    gzclose(compressed_file);
+
+    File_Reader* fr_compressed = file_reader_new(file_name);
+    assert(fr_compressed != NULL);
+    assert(file_reader_get_no_of_lines(fr_compressed) == no_of_lines);
+
+    char* line_buf = file_reader_get_copy_of_line(fr_compressed, 1);
+    assert(strcmp(line_buf, "line 1") == 0);
+    file_reader_delete_copy_of_line(line_buf);
+
+    line_buf = file_reader_get_copy_of_line(fr_compressed, no_of_lines);
+    assert(strcmp(line_buf, "last") == 0);
+    file_reader_delete_copy_of_line(line_buf);
+
+    // compressed file is decompressed again, it is never continued
+    assert(file_reader_follow(fr_compressed) == FILE_READER_FOLLOW_RELOADED);
+    assert(file_reader_get_no_of_lines(fr_compressed) == no_of_lines);
+
+    File_Reader_Stream* stream = file_reader_stream_open(file_name, 16);
+    assert(stream != NULL);
+
+    File_Reader_Line_View line = {0};
+    size_t no_of_streamed_lines = 0;
+    char expected_line[32];
+
+    while (file_reader_stream_next_line(stream, &line) == true)
+    {
+        ++no_of_streamed_lines;
+        if (no_of_streamed_lines < no_of_lines)
+        {
+            snprintf(expected_line, sizeof(expected_line), "line %zu", no_of_streamed_lines);
+            assert(line.len == strlen(expected_line) && memcmp(line.data, expected_line, line.len) == 0);
+        }
+    }
+    assert(file_reader_stream_has_error(stream) == false);
+    assert(no_of_streamed_lines == no_of_lines);
+    assert(line.len == 4 && memcmp(line.data, "last", 4) == 0);
+    file_reader_stream_close(stream);
+
+    // decompression can be turned off
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.decompress = false;
+
+    File_Reader* fr_raw = file_reader_new_ex(file_name, &options);
+    assert(fr_raw != NULL);
+    assert(file_reader_get_file_size(fr_raw) < file_reader_get_file_size(fr_compressed));
+    assert((unsigned char)file_reader_get_file_buffer(fr_raw)[0] == 0x1f);
+
+    // truncated file is damaged, it is not read as shorter content
+    FILE* truncated_file = fopen(truncated_file_name, "w");
+    assert(truncated_file != NULL);
+    fwrite(file_reader_get_file_buffer(fr_raw), 1, file_reader_get_file_size(fr_raw) / 2, truncated_file);
+    fclose(truncated_file);
+
+    assert(file_reader_new(truncated_file_name) == NULL);
+
+    stream = file_reader_stream_open(truncated_file_name, 0);
+    assert(stream != NULL);
+    while (file_reader_stream_next_line(stream, &line) == true)
+    {
+    }
+    assert(file_reader_stream_has_error(stream) == true);
+    file_reader_stream_close(stream);
+
+    // empty content has no reader, as empty file
+    compressed_file = gzopen(file_name, "wb");
+    assert(compressed_file != NULL);
+    gzclose(compressed_file);
+    assert(file_reader_new(file_name) == NULL);
+
+    // size in the trailer of crafted file is not allocated up front
+    compressed_file = gzopen(file_name, "wb");
+    assert(compressed_file != NULL);
+    assert(gzputs(compressed_file, "ab\ncd\n") > 0);
+    gzclose(compressed_file);
+
+    truncated_file = fopen(file_name, "r+b");
+    assert(truncated_file != NULL);
+    fseek(truncated_file, -4, SEEK_END);
+    fwrite("\xf0\xff\xff\xff", 1, 4, truncated_file);
+    fclose(truncated_file);
+
+    size_t largest_allocation = 0;
+    options.decompress = true;
+    options.allocator.allocate = largest_allocate;
+    options.allocator.reallocate = largest_reallocate;
+    options.allocator.deallocate = largest_deallocate;
+    options.allocator.context = &largest_allocation;
+
+    // damaged trailer is found after decompression
+    assert(file_reader_new_ex(file_name, &options) == NULL);
+    assert(largest_allocation > 0 && largest_allocation < 64 * 1024);
+
+    file_reader_delete(fr_raw);
+    file_reader_delete(fr_compressed);
+
+    remove(file_name);
+    remove(truncated_file_name);
+#endif
+}
+
+#ifdef FILE_READER_WITH_STATS
+static void count_phase(void* const phase_counters, const File_Reader_Trace_Event* const event)
+{
+    assert(event->file_name != NULL && event->is_successful == true);
+    ++((size_t*)phase_counters)[event->phase];
+}
+#endif
+
+/*
+    Stats count work of each reader and of all readers, without FILE_READER_WITH_STATS they are not available
+*/
+static void file_reader_stats_test(void)
+{
+    const char* file_name = "example_file.txt";
+    FILE* example_file = fopen(file_name, "w");
+    assert(example_file != NULL);
+    fputs("ab\ncd\nefg\n", example_file);
+    fclose(example_file);
+
+    File_Reader_Stats stats;
+    File_Reader_Stats global_stats;
+
+#ifdef FILE_READER_WITH_STATS
+    size_t phase_counters[FILE_READER_NO_OF_PHASES] = {0};
+    file_reader_set_trace_callback(count_phase, phase_counters);
+
+    assert(file_reader_get_global_stats(&global_stats) == true);
+    const uint64_t global_bytes_read = global_stats.bytes_read;
+
+    File_Reader* fr_counted = file_reader_new(file_name);
+    assert(fr_counted != NULL);
+    assert(file_reader_get_no_of_lines(fr_counted) == 3);
+
+    assert(file_reader_get_stats(fr_counted, &stats) == true);
+    assert(stats.bytes_read == 10);
+    assert(stats.no_of_read_calls >= 1);
+    assert(stats.no_of_read_retries == 0);
+    assert(stats.no_of_buffer_regrowths == 0);
+    // reader, buffer and line index
+    assert(stats.no_of_allocations >= 3);
+
+    for (size_t i = 0; i < FILE_READER_NO_OF_PHASES; ++i)
+    {
+        assert(phase_counters[i] == 1);
+    }
+
+    assert(file_reader_get_global_stats(&global_stats) == true);
+    assert(global_stats.bytes_read >= global_bytes_read + 10);
+
+    // virtual file doesn't fit into the buffer from the hint
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.virtual_file_size_hint = 1;
+
+    File_Reader* fr_virtual = file_reader_new_ex("/proc/self/maps", &options);
+    assert(fr_virtual != NULL);
+    assert(file_reader_get_stats(fr_virtual, &stats) == true);
+    assert(stats.no_of_buffer_regrowths > 0);
+    assert(stats.bytes_read == file_reader_get_file_size(fr_virtual));
+
+    file_reader_set_trace_callback(NULL, NULL);
+    file_reader_delete(fr_virtual);
+#else
+    File_Reader* fr_counted = file_reader_new(file_name);
+    assert(fr_counted != NULL);
+
+    assert(file_reader_get_stats(fr_counted, &stats) == false);
+    assert(stats.bytes_read == 0 && stats.no_of_allocations == 0);
+    assert(file_reader_get_global_stats(&global_stats) == false);
+#endif
+
+    file_reader_delete(fr_counted);
+    remove(file_name);
+}
+
+/*
+    Every read mode gives the same content, file is longer than one block of direct reads
+    and its size is not aligned
+*/
+static void file_reader_read_mode_test(void)
+{
+    const char* file_name = "example_file.txt";
+    FILE* example_file = fopen(file_name, "w");
+    assert(example_file != NULL);
+
+    const size_t no_of_lines = 300000;
+    for (size_t i = 1; i < no_of_lines; ++i)
+    {
+        fprintf(example_file, "line %zu\n", i);
+    }
+    fputs("last", example_file);
+    fclose(example_file);
+
+    File_Reader* fr_cached = file_reader_new(file_name);
+    assert(fr_cached != NULL);
+    assert(file_reader_get_file_size(fr_cached) > 2 * 1024 * 1024);
+
+    const File_Reader_Read_Mode read_modes[] = {FILE_READER_READ_ONCE, FILE_READER_READ_DIRECT};
+
+    for (size_t i = 0; i < sizeof(read_modes) / sizeof(read_modes[0]); ++i)
+    {
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.read_mode = read_modes[i];
+
+        File_Reader* fr_read = file_reader_new_ex(file_name, &options);
+        assert(fr_read != NULL);
+        assert(file_reader_get_file_size(fr_read) == file_reader_get_file_size(fr_cached));
+        assert(memcmp(file_reader_get_file_buffer(fr_read), file_reader_get_file_buffer(fr_cached),
+                      file_reader_get_file_size(fr_cached) + 1) == 0);
+        assert(file_reader_get_no_of_lines(fr_read) == no_of_lines);
+
+        char* line_buf = file_reader_get_copy_of_line(fr_read, no_of_lines);
+        assert(strcmp(line_buf, "last") == 0);
+        file_reader_delete_copy_of_line(line_buf);
+
+        // refresh reads the file again in the same mode
+        assert(file_reader_refresh(fr_read) == true);
+        assert(file_reader_get_no_of_lines(fr_read) == no_of_lines);
+
+        file_reader_delete(fr_read);
+    }
+
+    file_reader_delete(fr_cached);
+    remove(file_name);
+}
+
+/*
+    File is opened relative to directory descriptor, also when it is read again,
+    pipes are read until EOF and other files which are not regular are refused
+*/
+static void file_reader_open_at_test(void)
+{
+    const char* dir_name = "example_dir";
+    const char* file_name = "example_dir/example_file.txt";
+    const char* fifo_name = "example_dir/example_fifo";
+
+    assert(mkdir(dir_name, 0755) == 0);
+    append_to_file(file_name, "w", "ab\ncd\n");
+
+    const int dir_fd = open(dir_name, O_RDONLY | O_DIRECTORY);
+    assert(dir_fd != -1);
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        File_Reader_Options options;
+        file_reader_options_init(&options);
+        options.mapped = i == 1;
+        options.line_index_file = true;
+
+        File_Reader* fr_at = file_reader_new_at(dir_fd, "example_file.txt", &options);
+        assert(fr_at != NULL);
+        assert(file_reader_get_no_of_lines(fr_at) == 2);
+        assert(strcmp(file_reader_get_file_buffer(fr_at), "ab\ncd\n") == 0);
+
+        // line index file is saved next to the file, not in the current directory
+        assert(access("example_dir/example_file.txt.lidx", F_OK) == 0);
+        assert(access("example_file.txt.lidx", F_OK) != 0);
+
+        append_to_file(file_name, "a", "ef\n");
+        assert(file_reader_follow_wait(fr_at, 0) == true);
+        assert(file_reader_follow(fr_at) == FILE_READER_FOLLOW_APPENDED);
+        assert(file_reader_get_no_of_lines(fr_at) == 3);
+
+        // empty file has no reader, kind of file is found again when it is refreshed
+        append_to_file(file_name, "w", "");
+        assert(file_reader_refresh(fr_at) == false);
+        assert(file_reader_get_no_of_lines(fr_at) == 0);
+
+        append_to_file(file_name, "w", "ab\ncd\n");
+        assert(file_reader_refresh(fr_at) == true);
+        assert(file_reader_get_no_of_lines(fr_at) == 2);
+
+        file_reader_delete(fr_at);
+        remove("example_dir/example_file.txt.lidx");
+    }
+
+    // writer opens the pipe after the reader, content is read until the writer closes it
+    assert(mkfifo(fifo_name, 0600) == 0);
+
+    pthread_t writing_thread;
+    assert(pthread_create(&writing_thread, NULL, append_after_delay, (void*)fifo_name) == 0);
+    File_Reader* fr_fifo = file_reader_new_at(dir_fd, "example_fifo", NULL);
+    pthread_join(writing_thread, NULL);
+
+    assert(fr_fifo != NULL);
+    assert(strcmp(file_reader_get_file_buffer(fr_fifo), "late line\n") == 0);
+    assert(file_reader_get_no_of_lines(fr_fifo) == 1);
+    file_reader_delete(fr_fifo);
+
+    // directory is not read
+    assert(file_reader_new(dir_name) == NULL);
+    assert(file_reader_new_at(dir_fd, ".", NULL) == NULL);
+    assert(file_reader_new_at(dir_fd, "not_existing_file.txt", NULL) == NULL);
+
+    // absolute file name doesn't depend on directory
+    File_Reader* fr_absolute = file_reader_new_at(dir_fd, "/proc/self/status", NULL);
+    assert(fr_absolute != NULL);
+    assert(file_reader_get_no_of_lines(fr_absolute) > 0);
+    file_reader_delete(fr_absolute);
+
+    close(dir_fd);
+    remove(fifo_name);
+    remove(file_name);
+    assert(rmdir(dir_name) == 0);
+}
+
+static bool sum_first_fields(void* context, size_t line, const File_Reader_Line_View* fields, size_t no_of_fields)
+{
+    uint64_t* sum = context;
+    uint64_t value = 0;
+
+    (void)line;
+    if (no_of_fields > 0 && file_reader_parse_uint(fields[0], &value) == true)
+    {
+        *sum += value;
+    }
+
+    return *sum < 100;
+}
+
+static bool is_field_equal(File_Reader_Line_View field, const char* expected)
+{
+    return field.len == strlen(expected) && memcmp(field.data, expected, field.len) == 0;
+}
+
+/*
+    Fields are views of the reader buffer, collapsed whitespace and exact delimiters give
+    the same fields as splitting of the copy of line, numbers are parsed without copies
+*/
+static void file_reader_fields_test(void)
+{
+    const char* file_name = "example_file.txt";
+    FILE* example_file = fopen(file_name, "w");
+    assert(example_file != NULL);
+
+    fputs("cpu  10132153 290696 3084719 46828483 16683 0 25195 0 0 0\n"
+          "name\tvalue\t\tlast\n"
+          "  leading and   trailing \t \n"
+          "\n"
+          "alpha beta gamma delta epsilon zeta eta theta iota kappa lambda mu nu xi omicron pi rho\n"
+          "7\n"
+          "95\n"
+          "5", example_file);
+    fclose(example_file);
+
+    File_Reader* fr = file_reader_new(file_name);
+    assert(fr != NULL);
+    const char* buffer = file_reader_get_file_buffer(fr);
+
+    File_Reader_Line_View fields[32];
+    File_Reader_Delimiters tabs;
+    file_reader_delimiters_init(&tabs, "\t", false);
+
+    // /proc/stat line, fields point into the buffer
+    assert(file_reader_get_fields(fr, 1, NULL, fields, 32) == 11);
+    assert(fields[0].data == buffer && is_field_equal(fields[0], "cpu"));
+    assert(is_field_equal(fields[1], "10132153") && is_field_equal(fields[10], "0"));
+
+    uint64_t user_time = 0;
+    assert(file_reader_parse_uint(fields[1], &user_time) == true && user_time == 10132153);
+    assert(file_reader_parse_uint(fields[0], &user_time) == false && user_time == 10132153);
+
+    // fields over max are not returned
+    assert(file_reader_get_fields(fr, 1, NULL, fields, 3) == 3);
+    assert(is_field_equal(fields[2], "290696"));
+
+    // tab separated line keeps empty fields
+    assert(file_reader_get_fields(fr, 2, &tabs, fields, 32) == 4);
+    assert(is_field_equal(fields[0], "name") && is_field_equal(fields[2], "") && is_field_equal(fields[3], "last"));
+
+    assert(file_reader_get_fields(fr, 3, NULL, fields, 32) == 3);
+    assert(is_field_equal(fields[0], "leading") && is_field_equal(fields[2], "trailing"));
+
+    // empty line has no collapsed fields, but one exact field
+    assert(file_reader_get_fields(fr, 4, NULL, fields, 32) == 0);
+    assert(file_reader_get_fields(fr, 4, &tabs, fields, 32) == 1 && fields[0].len == 0);
+
+    // long line is scanned in vectors, the same set of delimiters is found also by lookup table only
+    File_Reader_Delimiters many_delimiters;
+    file_reader_delimiters_init(&many_delimiters, " !\"#$%&'()*", true);
+    assert(many_delimiters.no_of_characters == 0);
+
+    char* line_copy = file_reader_get_copy_of_line(fr, 5);
+    size_t no_of_tokens = 0;
+    const size_t no_of_fields = file_reader_get_fields(fr, 5, NULL, fields, 32);
+    File_Reader_Line_View table_fields[32];
+    assert(file_reader_get_fields(fr, 5, &many_delimiters, table_fields, 32) == no_of_fields);
+
+    for (char* token = strtok(line_copy, " "); token != NULL; token = strtok(NULL, " "), ++no_of_tokens)
+    {
+        assert(is_field_equal(fields[no_of_tokens], token));
+        assert(is_field_equal(table_fields[no_of_tokens], token));
+    }
+    assert(no_of_tokens == no_of_fields && no_of_fields == 17);
+    assert(is_field_equal(fields[16], "rho"));
+    file_reader_delete_copy_of_line(line_copy);
+
+    // lines 6-8 have numbers, callback stops when the sum gets to 100
+    uint64_t sum = 0;
+    assert(file_reader_get_fields_each(fr, 6, 10, NULL, fields, 32, sum_first_fields, &sum) == 2 && sum == 102);
+    sum = 0;
+    assert(file_reader_get_fields_each(fr, 8, 10, NULL, fields, 32, sum_first_fields, &sum) == 1 && sum == 5);
+    assert(file_reader_get_fields_each(fr, 9, 10, NULL, fields, 32, sum_first_fields, &sum) == 0);
+    assert(file_reader_get_fields(fr, 9, NULL, fields, 32) == 0);
+
+    file_reader_delete(fr);
+
+    // '\n' at the end of file, as in /proc/stat, is not a part of the last field
+    append_to_file(file_name, "w", "cpu 1 2\nintr 3 4\n");
+    fr = file_reader_new(file_name);
+    assert(fr != NULL);
+
+    uint64_t last_value = 0;
+    assert(file_reader_get_fields(fr, 2, NULL, fields, 32) == 3);
+    assert(is_field_equal(fields[2], "4") && file_reader_parse_uint(fields[2], &last_value) == true && last_value == 4);
+    assert(file_reader_get_fields(fr, 2, &tabs, fields, 32) == 1 && is_field_equal(fields[0], "intr 3 4"));
+
+    file_reader_delete(fr);
+    remove(file_name);
+
+    // integers of all lengths, parts of 8 digits are converted at once
+    uint64_t number = 1;
+    for (size_t i = 0; i < 64; ++i, number = number * 3 + i)
+    {
+        char text[32];
+        uint64_t uint_value = 0;
+        int64_t int_value = 0;
+
+        snprintf(text, sizeof(text), "%llu", (unsigned long long)number);
+        assert(file_reader_parse_uint((File_Reader_Line_View){text, strlen(text)}, &uint_value) == true);
+        assert(uint_value == number);
+
+        snprintf(text, sizeof(text), "-%llu", (unsigned long long)(number >> 1));
+        assert(file_reader_parse_int((File_Reader_Line_View){text, strlen(text)}, &int_value) == true);
+        assert(int_value == -(int64_t)(number >> 1));
+    }
+
+    const struct
+    {
+        const char* text;
+        bool        is_uint;
+        bool        is_int;
+    } numbers[] = {{"18446744073709551615", true, false}, {"18446744073709551616", false, false},
+                   {"00000000000000000000000042", true, true}, {"9223372036854775807", true, true},
+                   {"9223372036854775808", true, false}, {"-9223372036854775808", false, true},
+                   {"-9223372036854775809", false, false}, {"+12", false, true}, {"", false, false},
+                   {"-", false, false}, {"1234567a", false, false}, {"12345678:", false, false},
+                   {"123456789012345/", false, false}};
+
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i)
+    {
+        const File_Reader_Line_View field = {numbers[i].text, strlen(numbers[i].text)};
+        uint64_t uint_value = 0;
+        int64_t int_value = 0;
+
+        assert(file_reader_parse_uint(field, &uint_value) == numbers[i].is_uint);
+        assert(file_reader_parse_int(field, &int_value) == numbers[i].is_int);
+    }
+
+    int64_t min_value = 0;
+    assert(file_reader_parse_int((File_Reader_Line_View){"-9223372036854775808", 20}, &min_value) == true);
+    assert(min_value == INT64_MIN);
+
+    // /proc/stat is parsed without any allocation
+    File_Reader* fr_stat = file_reader_new("/proc/stat");
+    assert(fr_stat != NULL);
+    assert(file_reader_get_fields(fr_stat, 1, NULL, fields, 32) > 4 && is_field_equal(fields[0], "cpu"));
+    for (size_t i = 1; i < 5; ++i)
+    {
+        uint64_t ticks = 0;
+        assert(file_reader_parse_uint(fields[i], &ticks) == true);
+    }
+    file_reader_delete(fr_stat);
+
+    assert(file_reader_get_fields(NULL, 1, NULL, fields, 32) == 0);
+    assert(file_reader_split_line((File_Reader_Line_View){NULL, 0}, NULL, fields, 32) == 0);
+}
+
+/*
+    Values of "key: value" lines are found by key without scanning the file,
+    index follows the content after refresh and follow
+*/
+static void file_reader_kv_index_test(void)
+{
+    const char* file_name = "example_file.txt";
+    FILE* example_file = fopen(file_name, "w");
+    assert(example_file != NULL);
+
+    fputs("MemTotal:       16318416 kB\n"
+          "MemAvailable:    8040304 kB\n"
+          "Name:\tbash\n"
+          "Empty:\n"
+          "  Spaced key  :  v a l \r\n"
+          "no separator in line\n"
+          ": no key\n"
+          "MemTotal: 1\n"
+          "Negative: -42\n", example_file);
+
+    // table is enlarged a few times
+    for (size_t i = 0; i < 500; ++i)
+    {
+        fprintf(example_file, "key_%zu: %zu\n", i, i * 3);
+    }
+    fclose(example_file);
+
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.kv_separator = ':';
+
+    File_Reader* fr = file_reader_new_ex(file_name, &options);
+    assert(fr != NULL);
+    const char* buffer = file_reader_get_file_buffer(fr);
+
+    // value is a view of the buffer, the first line with key wins
+    const File_Reader_Line_View mem_total = file_reader_kv_get(fr, "MemTotal");
+    assert(mem_total.data == buffer + strlen("MemTotal:       "));
+    assert(mem_total.len == strlen("16318416 kB") && memcmp(mem_total.data, "16318416 kB", mem_total.len) == 0);
+
+    uint64_t uint_value = 0;
+    int64_t int_value = 0;
+    assert(file_reader_kv_get_uint(fr, "MemAvailable", &uint_value) == true && uint_value == 8040304);
+    assert(file_reader_kv_get_int(fr, "Negative", &int_value) == true && int_value == -42);
+    assert(file_reader_kv_get_uint(fr, "Negative", &uint_value) == false && uint_value == 8040304);
+    assert(file_reader_kv_get_uint(fr, "Name", &uint_value) == false);
+
+    File_Reader_Line_View value = file_reader_kv_get(fr, "Name");
+    assert(value.len == 4 && memcmp(value.data, "bash", 4) == 0);
+    value = file_reader_kv_get(fr, "Spaced key");
+    assert(value.len == 5 && memcmp(value.data, "v a l", 5) == 0);
+    value = file_reader_kv_get(fr, "Empty");
+    assert(value.data != NULL && value.len == 0);
+
+    assert(file_reader_kv_get(fr, "no separator in line").data == NULL);
+    assert(file_reader_kv_get(fr, "").data == NULL);
+    assert(file_reader_kv_get(fr, "MemFree").data == NULL);
+    assert(file_reader_kv_get(fr, NULL).data == NULL);
+
+    for (size_t i = 0; i < 500; ++i)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), "key_%zu", i);
+        assert(file_reader_kv_get_uint(fr, key, &uint_value) == true && uint_value == i * 3);
+    }
+
+    // refresh indexes the new content, follow indexes appended lines
+    append_to_file(file_name, "w", "MemTotal: 7\nSwap: 1");
+    assert(file_reader_refresh(fr) == true);
+    assert(file_reader_kv_get_uint(fr, "MemTotal", &uint_value) == true && uint_value == 7);
+    assert(file_reader_kv_get(fr, "key_0").data == NULL);
+
+    append_to_file(file_name, "a", "23\nCached: 5\n");
+    assert(file_reader_follow(fr) == FILE_READER_FOLLOW_APPENDED);
+    assert(file_reader_kv_get_uint(fr, "Swap", &uint_value) == true && uint_value == 123);
+    assert(file_reader_kv_get_uint(fr, "Cached", &uint_value) == true && uint_value == 5);
+
+    remove(file_name);
+    assert(file_reader_refresh(fr) == false);
+    assert(file_reader_kv_get(fr, "MemTotal").data == NULL);
+    file_reader_delete(fr);
+
+    // reader without separator has no key/value index
+    File_Reader* fr_meminfo = file_reader_new("/proc/meminfo");
+    assert(fr_meminfo != NULL);
+    assert(file_reader_kv_get(fr_meminfo, "MemTotal").data == NULL);
+    file_reader_delete(fr_meminfo);
+
+    fr_meminfo = file_reader_new_ex("/proc/meminfo", &options);
+    assert(fr_meminfo != NULL);
+    assert(file_reader_kv_get_uint(fr_meminfo, "MemTotal", &uint_value) == true && uint_value > 0);
+    assert(file_reader_kv_get_uint(fr_meminfo, "MemAvailable", &uint_value) == true);
+    file_reader_delete(fr_meminfo);
+
+    File_Reader* fr_status = file_reader_new_ex("/proc/self/status", &options);
+    assert(fr_status != NULL);
+    assert(file_reader_kv_get_int(fr_status, "Pid", &int_value) == true && int_value == (int64_t)getpid());
+    file_reader_delete(fr_status);
+}
+
+static void* acquire_cached_file(void* cache)
+{
+    for (size_t i = 0; i < 200; ++i)
+    {
+        const File_Reader* fr = file_reader_cache_acquire(cache, "example_cache_a.txt");
+        assert(fr != NULL);
+        assert(file_reader_get_no_of_lines(fr) == 3);
+        file_reader_cache_release(cache, fr);
+    }
+
+    return NULL;
+}
+
+/*
+    Readers of unchanged files are shared, changed files are loaded again,
+    the least recently released readers are evicted when the budget is exceeded
+*/
+static void file_reader_cache_test(void)
+{
+    const char* file_names[] = {"example_cache_a.txt", "example_cache_b.txt", "example_cache_c.txt"};
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        append_to_file(file_names[i], "w", "first\nsecond\nthird\n");
+    }
+
+    File_Reader_Cache_Stats stats;
+    File_Reader_Cache* cache = file_reader_cache_new(SIZE_MAX, NULL);
+    assert(cache != NULL);
+
+    const File_Reader* fr_first = file_reader_cache_acquire(cache, file_names[0]);
+    const File_Reader* fr_second = file_reader_cache_acquire(cache, file_names[0]);
+    assert(fr_first != NULL && fr_first == fr_second);
+    assert(strcmp(file_reader_get_file_name(fr_first), file_names[0]) == 0);
+
+    assert(file_reader_cache_get_stats(cache, &stats) == true);
+    assert(stats.no_of_hits == 1 && stats.no_of_misses == 1 && stats.no_of_readers == 1);
+    assert(stats.memory_in_bytes > file_reader_get_file_size(fr_first));
+
+    file_reader_cache_release(cache, fr_first);
+    file_reader_cache_release(cache, fr_second);
+    assert(file_reader_cache_get_stats(cache, &stats) == true && stats.no_of_readers == 1);
+
+    const size_t memory_of_reader = stats.memory_in_bytes;
+    file_reader_cache_delete(cache);
+
+    // two readers fit into the budget
+    cache = file_reader_cache_new(2 * memory_of_reader, NULL);
+    assert(cache != NULL);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const File_Reader* fr = file_reader_cache_acquire(cache, file_names[i]);
+        assert(fr != NULL);
+        file_reader_cache_release(cache, fr);
+    }
+
+    assert(file_reader_cache_get_stats(cache, &stats) == true);
+    assert(stats.no_of_misses == 3 && stats.no_of_evictions == 1 && stats.no_of_readers == 2);
+
+    // the first file was evicted, the second one is still cached
+    const File_Reader* fr_b = file_reader_cache_acquire(cache, file_names[1]);
+    const File_Reader* fr_a = file_reader_cache_acquire(cache, file_names[0]);
+    assert(file_reader_cache_get_stats(cache, &stats) == true);
+    assert(stats.no_of_hits == 1 && stats.no_of_misses == 4 && stats.no_of_evictions == 2);
+    file_reader_cache_release(cache, fr_a);
+
+    // changed file is loaded again, the old reader stays valid until it is released
+    append_to_file(file_names[1], "w", "changed\n");
+    const File_Reader* fr_changed = file_reader_cache_acquire(cache, file_names[1]);
+    assert(fr_changed != NULL && fr_changed != fr_b);
+    assert(strcmp(file_reader_get_file_buffer(fr_changed), "changed\n") == 0);
+    assert(strcmp(file_reader_get_file_buffer(fr_b), "first\nsecond\nthird\n") == 0);
+    file_reader_cache_release(cache, fr_b);
+    file_reader_cache_release(cache, fr_changed);
+    assert(file_reader_cache_acquire(cache, file_names[1]) == fr_changed);
+    file_reader_cache_release(cache, fr_changed);
+
+    // file replaced by another one of the same size is a different file
+    append_to_file("example_cache_replacement.txt", "w", "replace\n");
+    assert(rename("example_cache_replacement.txt", file_names[1]) == 0);
+    const File_Reader* fr_replaced = file_reader_cache_acquire(cache, file_names[1]);
+    assert(fr_replaced != NULL && strcmp(file_reader_get_file_buffer(fr_replaced), "replace\n") == 0);
+    assert(file_reader_cache_acquire(cache, file_names[1]) == fr_replaced);
+    file_reader_cache_release(cache, fr_replaced);
+    file_reader_cache_release(cache, fr_replaced);
+
+    // files without size are not cached, each acquire gets its own reader
+    const File_Reader* fr_status = file_reader_cache_acquire(cache, "/proc/self/status");
+    assert(fr_status != NULL && file_reader_get_no_of_lines(fr_status) > 0);
+    assert(file_reader_cache_get_stats(cache, &stats) == true && stats.no_of_readers <= 2);
+    file_reader_cache_release(cache, fr_status);
+
+    assert(file_reader_cache_acquire(cache, "not_existing_file.txt") == NULL);
+    assert(file_reader_cache_acquire(NULL, file_names[0]) == NULL);
+
+    // concurrent acquires share one reader
+    pthread_t threads[4];
+    for (size_t i = 0; i < 4; ++i)
+    {
+        assert(pthread_create(&threads[i], NULL, acquire_cached_file, cache) == 0);
+    }
+    for (size_t i = 0; i < 4; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // each thread loads the file at most once
+    const File_Reader_Cache_Stats stats_before = stats;
+    assert(file_reader_cache_get_stats(cache, &stats) == true);
+    assert(stats.no_of_hits + stats.no_of_misses == stats_before.no_of_hits + stats_before.no_of_misses + 800);
+    assert(stats.no_of_misses - stats_before.no_of_misses <= 4);
+
+    file_reader_cache_delete(cache);
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        remove(file_names[i]);
+    }
+}
+
+typedef struct Async_Result
+{
+    bool   is_called;
+    size_t no_of_lines;
+    int    error;
+} Async_Result;
+
+static void store_async_result(void* user_data, File_Reader* file_reader, int error)
+{
+    Async_Result* result = user_data;
+
+    assert(result->is_called == false);
+    assert((file_reader != NULL) == (error == 0));
+
+    result->is_called = true;
+    result->no_of_lines = file_reader_get_no_of_lines(file_reader);
+    result->error = error;
+    file_reader_delete(file_reader);
+}
+
+/*
+    Files are loaded in background, callbacks are called by dispatch in the thread
+    which polls the fd, deleted loader gives all callbacks before it returns
+*/
+static void file_reader_async_test(void)
+{
+    const char* file_name = "example_file.txt";
+    append_to_file(file_name, "w", "ab\ncd\nef");
+
+    File_Reader_Async* async = file_reader_async_new(2, NULL);
+    assert(async != NULL);
+    assert(file_reader_async_get_fd(async) != -1);
+
+    // nothing is finished yet
+    assert(file_reader_async_dispatch(async) == 0);
+
+    const char* file_names[] = {file_name, "not_existing_file.txt", "/proc/self/status"};
+    Async_Result results[3] = {{false, 0, 0}, {false, 0, 0}, {false, 0, 0}};
+
+    for (size_t i = 0; i < 3; ++i)
+    {
+        assert(file_reader_new_async(async, file_names[i], store_async_result, &results[i]) == true);
+    }
+
+    size_t no_of_callbacks = 0;
+    while (no_of_callbacks < 3)
+    {
+        struct pollfd poll_fd = {file_reader_async_get_fd(async), POLLIN, 0};
+        assert(poll(&poll_fd, 1, 5000) == 1);
+        no_of_callbacks += file_reader_async_dispatch(async);
+    }
+
+    assert(results[0].is_called == true && results[0].error == 0 && results[0].no_of_lines == 3);
+    assert(results[1].is_called == true && results[1].error == ENOENT);
+    assert(results[2].is_called == true && results[2].error == 0 && results[2].no_of_lines > 0);
+
+    assert(file_reader_new_async(async, NULL, store_async_result, &results[0]) == false);
+    assert(file_reader_new_async(async, file_name, NULL, NULL) == false);
+    file_reader_async_delete(async);
+
+    // loads which are not dispatched or not started yet get their callbacks on delete
+    async = file_reader_async_new(1, NULL);
+    assert(async != NULL);
+
+    Async_Result pending_results[20];
+    memset(pending_results, 0, sizeof(pending_results));
+
+    for (size_t i = 0; i < 20; ++i)
+    {
+        assert(file_reader_new_async(async, file_name, store_async_result, &pending_results[i]) == true);
+    }
+    file_reader_async_delete(async);
+
+    for (size_t i = 0; i < 20; ++i)
+    {
+        assert(pending_results[i].is_called == true);
+        assert(pending_results[i].error == 0 || pending_results[i].error == ECANCELED);
+    }
+
+    remove(file_name);
+}
+
+static void assert_tail_lines(File_Reader* file_reader, const char* const* lines, size_t no_of_lines)
+{
+    assert(file_reader != NULL);
+    assert(file_reader_get_no_of_lines(file_reader) == no_of_lines);
+
+    for (size_t i = 0; i < no_of_lines; ++i)
+    {
+        const File_Reader_Line_View line_view = file_reader_get_line_view(file_reader, i + 1);
+        assert(line_view.len == strlen(lines[i]) && memcmp(line_view.data, lines[i], line_view.len) == 0);
+    }
+
+    file_reader_delete(file_reader);
+}
+
+/*
+    Tail reader has the same last lines as reader of the whole file, with or without '\n' at the end,
+    for files bigger than one block of backward read and for files which can't be read backwards
+*/
+static void file_reader_tail_test(void)
+{
+    const char* file_name = "example_file.txt";
+
+    append_to_file(file_name, "w", "ab\ncd\nef\n");
+    assert_tail_lines(file_reader_tail(file_name, 2), (const char*[]){"cd", "ef\n"}, 2);
+    assert_tail_lines(file_reader_tail(file_name, 1), (const char*[]){"ef\n"}, 1);
+    assert_tail_lines(file_reader_tail(file_name, 10), (const char*[]){"ab", "cd", "ef\n"}, 3);
+    assert(file_reader_tail(file_name, 0) == NULL);
+
+    append_to_file(file_name, "w", "ab\ncd\nef");
+    assert_tail_lines(file_reader_tail(file_name, 2), (const char*[]){"cd", "ef"}, 2);
+
+    append_to_file(file_name, "w", "a\n\n");
+    assert_tail_lines(file_reader_tail(file_name, 1), (const char*[]){"\n"}, 1);
+    assert_tail_lines(file_reader_tail(file_name, 2), (const char*[]){"a", "\n"}, 2);
+
+    // mapping is not used for tail, refresh and follow read the last lines again
+    File_Reader_Options options;
+    file_reader_options_init(&options);
+    options.mapped = true;
+    options.tail_no_of_lines = 1;
+    append_to_file(file_name, "w", "ab\ncd\n");
+    File_Reader* file_reader = file_reader_new_ex(file_name, &options);
+    assert(file_reader != NULL && file_reader_get_file_size(file_reader) == 3);
+    append_to_file(file_name, "a", "ef\n");
+    assert(file_reader_follow(file_reader) != FILE_READER_FOLLOW_ERROR);
+    assert_tail_lines(file_reader, (const char*[]){"ef\n"}, 1);
+
+    // lines cross blocks of backward read
+    FILE* example_file = fopen(file_name, "w");
+    assert(example_file != NULL);
+    for (size_t i = 0; i < 50000; ++i)
+    {
+        fprintf(example_file, "line %zu\n", i);
+    }
+    fclose(example_file);
+
+    File_Reader* whole_file_reader = file_reader_new(file_name);
+    assert(whole_file_reader != NULL && file_reader_get_no_of_lines(whole_file_reader) == 50000);
+
+    const size_t no_of_tail_lines = 20000;
+    file_reader = file_reader_tail(file_name, no_of_tail_lines);
+    assert(file_reader != NULL && file_reader_get_no_of_lines(file_reader) == no_of_tail_lines);
+
+    for (size_t line = 1; line <= no_of_tail_lines; ++line)
+    {
+        const File_Reader_Line_View tail_line = file_reader_get_line_view(file_reader, line);
+        const File_Reader_Line_View whole_line =
+            file_reader_get_line_view(whole_file_reader, 50000 - no_of_tail_lines + line);
+        assert(tail_line.len == whole_line.len && memcmp(tail_line.data, whole_line.data, tail_line.len) == 0);
+    }
+
+    file_reader_delete(file_reader);
+    file_reader_delete(whole_file_reader);
+
+    // virtual file is loaded whole and its first lines are dropped
+    file_reader = file_reader_tail("/proc/self/status", 1);
+    assert(file_reader != NULL && file_reader_get_no_of_lines(file_reader) == 1);
+    file_reader_delete(file_reader);
+
+    assert(file_reader_tail("not_existing_file.txt", 1) == NULL);
+
+    remove(file_name);
+}